@@ -0,0 +1,42 @@
+// Allocation counting for diagnostics builds: replaces the global operator
+// new so the metrics report heap allocations per call. Link it in only when
+// profiling; every other build keeps the standard allocator.
+//
+//   g++ mro_headless.cpp mro_core.cpp mro_alloc_count.cpp -std=c++17 -pthread -o mro_headless
+
+#include "mro_core.h"
+
+#include <cstdlib>
+#include <new>
+
+static thread_local uint64_t t_allocations = 0;
+
+static uint64_t CountedAllocations()
+{
+    return t_allocations;
+}
+
+static const bool g_allocationCounterSet = (SetAllocationCounter(&CountedAllocations), true);
+
+// Counts every heap allocation of the thread; the array and nothrow forms
+// forward to this one. Kept out of line so the compiler never pairs the
+// malloc and free across an inlined new/delete.
+#if defined(__GNUC__)
+#define MRO_NOINLINE __attribute__((noinline))
+#else
+#define MRO_NOINLINE __declspec(noinline)
+#endif
+
+MRO_NOINLINE void* operator new(std::size_t size)
+{
+    t_allocations++;
+    for (;;) {
+        if (void *p = std::malloc(size ? size : 1)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+MRO_NOINLINE void operator delete(void *p) noexcept { std::free(p); }
+MRO_NOINLINE void operator delete(void *p, std::size_t) noexcept { std::free(p); }
@@ -0,0 +1,395 @@
+// Benchmarks of the loaders and hot paths over synthetic data.
+//
+//   mro_bench [--dir DIR] [--tasks N] [--systems N] [--steps N] [--parts N]
+//             [--part-types N] [--orders N] [--runs N] [--seed N] [--json FILE]
+//   mro_bench --generate-only [same options]
+//
+// The generator writes DIR/tasks.txt (--tasks cards spread over --systems
+// systems, each with --steps steps and --parts parts drawn from --part-types
+// part names) and DIR/stock.txt, then every benchmark runs --runs times over
+// those files; the fastest run counts. A table goes to stderr and the
+// results go to stdout (or --json FILE) as one JSON document:
+//   {"timestamp":"2026-10-14T14:05:09+03:00","config":{...},"results":[
+//    {"benchmark":"load_tasks","items":1000000,"seconds":0.812,"items_per_sec":1231527,"ns_per_item":812.0},
+//    ...]}
+// Benchmarks (items are cards, parts or work orders):
+//   load_tasks        LoadTasksFromFile, text parse of tasks.txt
+//   compile_catalog   ReadCatalog without a cache: parse and write tasks.txt.cat
+//   load_tasks_cached ReadCatalog from an up-to-date tasks.txt.cat
+//   load_stock        LoadStockFromFile
+//   lookup            WorkOrderResolver::Resolve of random work orders
+//   deduct            CheckAndDeductParts of the resolved cards
+//   format_reports    DeductStock and FormatReport of the resolved cards
+//   write_reports     the same, written through g_reportWriter
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "mro_core.h"
+
+#include <cerrno>
+#include <random>
+
+// --------------------------- Options ---------------------------
+
+struct BenchConfig {
+    std::string dir = "bench_data";
+    size_t   tasks = 1000000;
+    size_t   systems = 100;
+    size_t   steps = 5;
+    size_t   parts = 3;
+    size_t   partTypes = 5000;
+    size_t   orders = 200000;
+    size_t   runs = 3;
+    uint32_t seed = 1;
+    std::string jsonFile;
+    bool     generateOnly = false;
+};
+
+static int Usage()
+{
+    fprintf(stderr,
+            "usage: mro_bench [--dir DIR] [--tasks N] [--systems N] [--steps N] [--parts N]\n"
+            "                 [--part-types N] [--orders N] [--runs N] [--seed N] [--json FILE]\n"
+            "       mro_bench --generate-only [same options]\n");
+    return 2;
+}
+
+// --------------------------- Generator ---------------------------
+// Deterministic for a given seed. Lines are rendered into one buffer that is
+// written out whenever it fills, so millions of lines cost no more memory
+// than a few.
+
+static const size_t kGeneratorBufferBytes = 1 << 20;
+static const int    kGeneratedStock = 1000000000; // units per part: no benchmark runs short
+
+static std::string SystemName(size_t s) { return "System " + std::to_string(s + 1); }
+static std::string TaskName(size_t t)   { return "Task " + std::to_string(t + 1); }
+static std::string PartName(size_t p)   { return "Part-" + std::to_string(p + 1); }
+
+class LineFile
+{
+public:
+    explicit LineFile(const std::string &filename) : m_file(fopen(filename.c_str(), "wb"))
+    {
+        m_buffer.reserve(kGeneratorBufferBytes + 4096);
+    }
+    ~LineFile() { Close(); }
+
+    bool IsOpen() const { return m_file != nullptr; }
+    std::string& Buffer() { return m_buffer; }
+
+    // Call after each line
+    void LineDone()
+    {
+        if (m_buffer.size() >= kGeneratorBufferBytes) Write();
+    }
+
+    bool Close()
+    {
+        if (!m_file) return m_ok;
+        Write();
+        m_ok = fclose(m_file) == 0 && m_ok;
+        m_file = nullptr;
+        return m_ok;
+    }
+
+private:
+    FILE       *m_file;
+    std::string m_buffer;
+    bool        m_ok = true;
+
+    void Write()
+    {
+        m_ok = m_ok && fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) == m_buffer.size();
+        m_buffer.clear();
+    }
+};
+
+static void AppendNumber(std::string &out, size_t value)
+{
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+// System|Task|step,step,...|part,part*2,...
+static bool GenerateTasks(const BenchConfig &config, const std::string &filename)
+{
+    LineFile file(filename);
+    if (!file.IsOpen()) return false;
+    std::mt19937 rng(config.seed);
+    std::vector<std::string> systems, partNames;
+    for (size_t s = 0; s < config.systems; s++) systems.push_back(SystemName(s));
+    for (size_t p = 0; p < config.partTypes; p++) partNames.push_back(PartName(p));
+    std::vector<size_t> chosen;
+    std::string &out = file.Buffer();
+    for (size_t t = 0; t < config.tasks; t++) {
+        out += systems[t % systems.size()];
+        out += "|Task ";
+        AppendNumber(out, t + 1);
+        out += '|';
+        for (size_t i = 0; i < config.steps; i++) {
+            if (i) out += ',';
+            out += "Step ";
+            AppendNumber(out, i + 1);
+            out += " of task ";
+            AppendNumber(out, t + 1);
+        }
+        out += '|';
+        // Distinct parts per card, quantity 1..3
+        chosen.clear();
+        while (chosen.size() < std::min(config.parts, partNames.size())) {
+            size_t part = rng() % partNames.size();
+            if (std::find(chosen.begin(), chosen.end(), part) != chosen.end()) continue;
+            if (!chosen.empty()) out += ',';
+            out += partNames[part];
+            unsigned quantity = 1 + rng() % 3;
+            if (quantity > 1) {
+                out += '*';
+                AppendNumber(out, quantity);
+            }
+            chosen.push_back(part);
+        }
+        out += '\n';
+        file.LineDone();
+    }
+    return file.Close();
+}
+
+// part|quantity
+static bool GenerateStock(const BenchConfig &config, const std::string &filename)
+{
+    LineFile file(filename);
+    if (!file.IsOpen()) return false;
+    std::string &out = file.Buffer();
+    for (size_t p = 0; p < config.partTypes; p++) {
+        out += PartName(p);
+        out += '|';
+        AppendNumber(out, static_cast<size_t>(kGeneratedStock));
+        out += '\n';
+        file.LineDone();
+    }
+    return file.Close();
+}
+
+// --------------------------- Benchmarks ---------------------------
+
+struct BenchResult {
+    std::string name;
+    size_t      items = 0;
+    double      seconds = 0; // fastest run
+};
+
+// Run 'body' config.runs times, 'setup' (untimed) before each run, and keep the fastest
+static BenchResult Measure(const BenchConfig &config, const std::string &name, size_t items,
+                           const std::function<void()> &setup, const std::function<bool()> &body)
+{
+    BenchResult result{name, items, 0};
+    for (size_t run = 0; run < config.runs; run++) {
+        if (setup) setup();
+        auto start = std::chrono::steady_clock::now();
+        bool ok = body();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (!ok) {
+            fprintf(stderr, "%s failed\n", name.c_str());
+            result.seconds = -1;
+            return result;
+        }
+        if (run == 0 || seconds < result.seconds) result.seconds = seconds;
+    }
+    fprintf(stderr, "%-18s %10zu items %10.3f s %14.0f items/s %10.1f ns/item\n", name.c_str(), items,
+            result.seconds, result.seconds > 0 ? items / result.seconds : 0.0,
+            items ? result.seconds * 1e9 / items : 0.0);
+    return result;
+}
+
+static bool MakeDirectory(const std::string &dir)
+{
+#ifdef _WIN32
+    return _mkdir(dir.c_str()) == 0 || errno == EEXIST;
+#else
+    return mkdir(dir.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+static std::string JsonResults(const BenchConfig &config, const std::vector<BenchResult> &results)
+{
+    std::string out = "{\"timestamp\":\"" + g_clock.Now() + "\",\"config\":{";
+    out += "\"tasks\":" + std::to_string(config.tasks) + ",\"systems\":" + std::to_string(config.systems) +
+           ",\"steps\":" + std::to_string(config.steps) + ",\"parts\":" + std::to_string(config.parts) +
+           ",\"part_types\":" + std::to_string(config.partTypes) + ",\"orders\":" + std::to_string(config.orders) +
+           ",\"runs\":" + std::to_string(config.runs) + ",\"seed\":" + std::to_string(config.seed) +
+           ",\"threads\":" + std::to_string(std::thread::hardware_concurrency()) + "},\"results\":[";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &r = results[i];
+        char line[256];
+        snprintf(line, sizeof(line),
+                 "%s\n{\"benchmark\":\"%s\",\"items\":%zu,\"seconds\":%.6f,\"items_per_sec\":%.0f,\"ns_per_item\":%.1f}",
+                 i ? "," : "", r.name.c_str(), r.items, r.seconds,
+                 r.seconds > 0 ? r.items / r.seconds : 0.0, r.items ? r.seconds * 1e9 / r.items : 0.0);
+        out += line;
+    }
+    out += "]}\n";
+    return out;
+}
+
+static int RunBenchmarks(const BenchConfig &config)
+{
+    const std::string tasksFile = config.dir + "/tasks.txt";
+    const std::string stockFile = config.dir + "/stock.txt";
+    const std::string cacheFile = tasksFile + ".cat";
+    const std::string reportFile = config.dir + "/maintenance_reports.txt";
+    const std::string journalFile = config.dir + "/maintenance_reports.jrn";
+    const std::string indexFile = config.dir + "/maintenance_reports.jrn.idx";
+    auto removeFiles = [](std::initializer_list<std::string> files) {
+        for (auto &f : files) std::remove(f.c_str());
+    };
+    auto resetCatalog = [] { PublishCatalog(std::make_shared<const TaskCatalog>()); };
+    std::vector<BenchResult> results;
+
+    // Loaders
+    results.push_back(Measure(config, "load_tasks", config.tasks, resetCatalog,
+                              [&] { return LoadTasksFromFile(tasksFile); }));
+    results.push_back(Measure(config, "compile_catalog", config.tasks,
+                              [&] { removeFiles({cacheFile}); },
+                              [&] { return ReadCatalog(tasksFile) != nullptr; }));
+    std::shared_ptr<const TaskCatalog> catalog;
+    results.push_back(Measure(config, "load_tasks_cached", config.tasks, nullptr,
+                              [&] { catalog = ReadCatalog(tasksFile); return catalog != nullptr; }));
+    if (!catalog) return 1;
+    PublishCatalog(catalog);
+    results.push_back(Measure(config, "load_stock", config.partTypes,
+                              [&] { removeFiles({stockFile + ".wal", stockFile + ".snap"}); },
+                              [&] { return LoadStockFromFile(stockFile); }));
+
+    // Random work orders over the generated cards
+    std::mt19937 rng(config.seed + 1);
+    std::vector<WorkOrder> orders(config.orders);
+    for (auto &order : orders) {
+        size_t task = rng() % config.tasks;
+        order.aircraft = "TC-" + std::to_string(rng() % 100);
+        order.system = SystemName(task % config.systems);
+        order.task = TaskName(task);
+    }
+
+    std::vector<TaskHandle> resolved;
+    results.push_back(Measure(config, "lookup", orders.size(), [&] { resolved.clear(); }, [&] {
+        WorkOrderResolver resolver(catalog);
+        std::string error;
+        for (auto &order : orders) {
+            TaskHandle task = resolver.Resolve(order, error);
+            if (!task) return false;
+            resolved.push_back(std::move(task));
+        }
+        return true;
+    }));
+    if (resolved.size() != orders.size()) return 1;
+
+    results.push_back(Measure(config, "deduct", resolved.size(), nullptr, [&] {
+        for (auto &task : resolved) {
+            if (!CheckAndDeductParts(task->requiredParts)) return false;
+        }
+        return true;
+    }));
+
+    // Reports: rendering alone, then through the writer with the journal.
+    // Each card's parts are deducted first, as CompleteBatch does, so the
+    // deductions the stock ledger records match the live stock.
+    uint32_t date = g_clock.Today();
+    results.push_back(Measure(config, "format_reports", resolved.size(), nullptr, [&] {
+        ReportBatch batch;
+        for (size_t i = 0; i < resolved.size(); i++) {
+            if (DeductStock(resolved[i]->requiredParts) != DeductResult::Done) return false;
+            FormatReport(NextReportId(), date, orders[i].aircraft, orders[i].system, *resolved[i], batch);
+        }
+        return !batch.text.empty();
+    }));
+    static const size_t kReportsPerBatch = 1000;
+    results.push_back(Measure(config, "write_reports", resolved.size(),
+                              [&] { removeFiles({reportFile, journalFile, indexFile}); }, [&] {
+        if (!g_reportJournal.Open(journalFile, indexFile) ||
+            !g_reportWriter.Start(reportFile, journalFile, indexFile, kReportSyncIntervalMs)) {
+            return false;
+        }
+        ReportBatch batch;
+        for (size_t i = 0; i < resolved.size(); i++) {
+            if (DeductStock(resolved[i]->requiredParts) != DeductResult::Done) return false;
+            FormatReport(NextReportId(), date, orders[i].aircraft, orders[i].system, *resolved[i], batch);
+            if ((i + 1) % kReportsPerBatch == 0) {
+                g_reportWriter.Submit(std::move(batch));
+                batch = ReportBatch();
+            }
+        }
+        if (!batch.text.empty()) g_reportWriter.Submit(std::move(batch));
+        g_reportWriter.Stop();
+        return true;
+    }));
+
+    std::string json = JsonResults(config, results);
+    if (config.jsonFile.empty()) {
+        fwrite(json.data(), 1, json.size(), stdout);
+    } else {
+        std::ofstream ofs(config.jsonFile, std::ios::binary | std::ios::trunc);
+        ofs << json;
+        if (!ofs) {
+            fprintf(stderr, "Could not write %s\n", config.jsonFile.c_str());
+            return 1;
+        }
+    }
+    for (auto &r : results) {
+        if (r.seconds < 0) return 1;
+    }
+    return 0;
+}
+
+// --------------------------- Main ---------------------------
+
+int main(int argc, char **argv)
+{
+    BenchConfig config;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto count = [&](size_t &out) {
+            if (i + 1 >= argc) return false;
+            char *end;
+            unsigned long long value = strtoull(argv[++i], &end, 10);
+            if (*end != '\0') return false;
+            out = static_cast<size_t>(value);
+            return true;
+        };
+        size_t seed = config.seed;
+        bool ok = true;
+        if (arg == "--dir" && i + 1 < argc)   config.dir = argv[++i];
+        else if (arg == "--json" && i + 1 < argc) config.jsonFile = argv[++i];
+        else if (arg == "--generate-only") config.generateOnly = true;
+        else if (arg == "--tasks")      ok = count(config.tasks);
+        else if (arg == "--systems")    ok = count(config.systems);
+        else if (arg == "--steps")      ok = count(config.steps);
+        else if (arg == "--parts")      ok = count(config.parts);
+        else if (arg == "--part-types") ok = count(config.partTypes);
+        else if (arg == "--orders")     ok = count(config.orders);
+        else if (arg == "--runs")       ok = count(config.runs);
+        else if (arg == "--seed")       { ok = count(seed); config.seed = static_cast<uint32_t>(seed); }
+        else return Usage();
+        if (!ok) return Usage();
+    }
+    if (!config.tasks || !config.systems || !config.partTypes || !config.runs) return Usage();
+
+    if (!MakeDirectory(config.dir)) {
+        fprintf(stderr, "Could not create %s\n", config.dir.c_str());
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    if (!GenerateTasks(config, config.dir + "/tasks.txt") || !GenerateStock(config, config.dir + "/stock.txt")) {
+        fprintf(stderr, "Could not write the synthetic data to %s\n", config.dir.c_str());
+        return 1;
+    }
+    fprintf(stderr, "Generated %zu tasks and %zu parts in %s (%.3f s)\n", config.tasks, config.partTypes,
+            config.dir.c_str(), std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    if (config.generateOnly) return 0;
+    return RunBenchmarks(config);
+}
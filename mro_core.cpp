@@ -0,0 +1,3878 @@
+// MRO core implementation (see mro_core.h)
+
+#include "mro_core.h"
+#include "mro_net.h"
+
+#ifdef _WIN32
+#include <windows.h> // lean, without min/max: mro_net.h defines both
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#endif
+
+#include <filesystem>
+#include <random>
+#include <unordered_set>
+
+// --------------------------- Logging ---------------------------
+
+static std::mutex g_logMutex;
+static LogSink    g_logSink;
+
+void SetLogSink(LogSink sink)
+{
+    std::lock_guard<std::mutex> lock(g_logMutex);
+    g_logSink = std::move(sink);
+}
+
+static void Log(LogLevel level, const std::string &message)
+{
+    std::lock_guard<std::mutex> lock(g_logMutex);
+    if (g_logSink) {
+        g_logSink(level, message);
+        return;
+    }
+    fprintf(stderr, "%s %s: %s\n", ClockService::Timestamp(time(nullptr)).c_str(),
+            level == LogLevel::Error ? "Error" : "Warning", message.c_str());
+}
+
+void LogWarning(const std::string &message) { Log(LogLevel::Warning, message); }
+void LogError(const std::string &message)   { Log(LogLevel::Error, message); }
+
+// --------------------------- Catalog Snapshot ---------------------------
+
+static std::shared_ptr<const TaskCatalog> systemTasks = std::make_shared<const TaskCatalog>();
+
+std::shared_ptr<const TaskCatalog> CatalogSnapshot()
+{
+    return std::atomic_load(&systemTasks);
+}
+
+void PublishCatalog(std::shared_ptr<const TaskCatalog> catalog)
+{
+    std::atomic_store(&systemTasks, std::move(catalog));
+}
+
+// Parts listed in "stock.txt", in name order (display order)
+std::vector<PartId> stockParts;
+// Quantities as last read from "stock.txt", sorted by PartId; a reload of the
+// file is merged into the live stock as the difference to these
+static std::vector<std::pair<PartId, int>> stockFileQuantities;
+
+// --------------------------- Helper Functions ---------------------------
+
+// Flush a stdio file and make it durable
+static void SyncFile(FILE *file)
+{
+    fflush(file);
+#ifdef _WIN32
+    _commit(_fileno(file));
+#else
+    fsync(fileno(file));
+#endif
+}
+
+// Replace 'to' with 'from' in one step
+static bool RenameOver(const std::string &from, const std::string &to)
+{
+#ifdef _WIN32
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+// Read-only view of a whole file mapped into memory (no copy into user buffers)
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile() { Close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string &filename)
+    {
+        Close();
+#ifdef _WIN32
+        m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file, &size)) { Close(); return false; }
+        m_size = static_cast<size_t>(size.QuadPart);
+        if (m_size == 0) return true; // empty file: nothing to map
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m_mapping) { Close(); return false; }
+        m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!m_data) { Close(); return false; }
+#else
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) { close(fd); return false; }
+        m_size = static_cast<size_t>(st.st_size);
+        if (m_size == 0) { close(fd); return true; } // empty file: nothing to map
+        void *addr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd); // the mapping keeps its own reference
+        if (addr == MAP_FAILED) { m_size = 0; return false; }
+        madvise(addr, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const char*>(addr);
+#endif
+        return true;
+    }
+
+    void Close()
+    {
+#ifdef _WIN32
+        if (m_data) UnmapViewOfFile(m_data);
+        if (m_mapping) CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+        m_mapping = nullptr;
+        m_file = INVALID_HANDLE_VALUE;
+#else
+        if (m_data) munmap(const_cast<char*>(m_data), m_size);
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    std::string_view View() const { return std::string_view(m_data, m_size); }
+
+private:
+    const char *m_data = nullptr;
+    size_t      m_size = 0;
+#ifdef _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#endif
+};
+
+PartRegistry g_partRegistry;
+
+// Display text of a requirement: "Part" for one unit, "Part x3" otherwise
+std::string PartLabel(const std::string &name, int quantity)
+{
+    return quantity == 1 ? name : name + " x" + std::to_string(quantity);
+}
+
+std::string PartLabel(const PartDemand &d)
+{
+    return PartLabel(g_partRegistry.Name(d.part), d.quantity);
+}
+
+// --------------------------- Task Catalog ---------------------------
+
+// Arrays of a catalog built in memory; its views point here
+struct CatalogArrays {
+    std::string               text;
+    std::vector<SystemRecord> systems;
+    std::vector<TaskRecord>   tasks;
+    std::vector<TextSpan>     steps;
+    std::vector<PartDemand>   parts;
+    std::vector<TextSpan>     types;
+    std::vector<TextSpan>     aircraftTypes;
+    std::vector<uint32_t>     applicableStart;
+    std::vector<uint32_t>     applicable;
+};
+
+TaskCatalog::TaskCatalog(std::string text, std::vector<SystemRecord> systems, std::vector<TaskRecord> tasks,
+                         std::vector<TextSpan> steps, std::vector<PartDemand> parts, std::vector<TextSpan> types)
+{
+    auto arrays = std::make_shared<CatalogArrays>();
+    arrays->text = std::move(text);
+    arrays->systems = std::move(systems);
+    arrays->tasks = std::move(tasks);
+    arrays->steps = std::move(steps);
+    arrays->parts = std::move(parts);
+    arrays->types = std::move(types);
+    m_text = arrays->text;
+    m_systems = arrays->systems;
+    m_tasks = arrays->tasks;
+    m_steps = arrays->steps;
+    m_parts = arrays->parts;
+    m_types = arrays->types;
+    BuildApplicability(arrays->aircraftTypes, arrays->applicableStart, arrays->applicable);
+    m_storage = std::move(arrays);
+    m_search.Build(*this);
+}
+
+TaskCatalog::TaskCatalog(std::shared_ptr<const void> storage, const Layout &layout)
+    : m_storage(storage), m_text(layout.text), m_systems(layout.systems), m_tasks(layout.tasks),
+      m_steps(layout.steps), m_parts(layout.parts), m_types(layout.types),
+      m_aircraftTypes(layout.aircraftTypes), m_applicableStart(layout.applicableStart),
+      m_applicable(layout.applicable)
+{
+    m_search.Attach(std::move(storage), layout.search, m_tasks.size());
+}
+
+void TaskCatalog::BuildApplicability(std::vector<TextSpan> &aircraftTypes, std::vector<uint32_t> &applicableStart,
+                                     std::vector<uint32_t> &applicable)
+{
+    auto less = [this](const TextSpan &a, const TextSpan &b) { return Text(a) < Text(b); };
+    auto same = [this](const TextSpan &a, const TextSpan &b) { return Text(a) == Text(b); };
+    aircraftTypes.assign(m_types.begin(), m_types.end());
+    std::sort(aircraftTypes.begin(), aircraftTypes.end(), less);
+    aircraftTypes.erase(std::unique(aircraftTypes.begin(), aircraftTypes.end(), same), aircraftTypes.end());
+    m_aircraftTypes = aircraftTypes;
+
+    size_t systems = m_systems.size();
+    size_t slots = m_aircraftTypes.size() + 1;
+    std::vector<std::vector<uint32_t>> buckets(slots * systems);
+    auto add = [&](size_t slot, size_t s, uint32_t position) {
+        std::vector<uint32_t> &bucket = buckets[slot * systems + s];
+        if (bucket.empty() || bucket.back() != position) bucket.push_back(position);
+    };
+    for (size_t s = 0; s < systems; s++) {
+        const SystemRecord &sys = m_systems[s];
+        for (uint32_t i = 0; i < sys.taskCount; i++) {
+            const TaskRecord &r = m_tasks[sys.firstTask + i];
+            if (r.typeCount == 0) {
+                for (size_t slot = 0; slot < slots; slot++) add(slot, s, i);
+                continue;
+            }
+            for (uint32_t t = 0; t < r.typeCount; t++) {
+                add(FindAircraftType(Text(m_types[r.firstType + t])) + 1, s, i);
+            }
+        }
+    }
+
+    applicableStart.assign(buckets.size() + 1, 0);
+    applicable.clear();
+    for (size_t b = 0; b < buckets.size(); b++) {
+        applicableStart[b] = static_cast<uint32_t>(applicable.size());
+        applicable.insert(applicable.end(), buckets[b].begin(), buckets[b].end());
+    }
+    applicableStart[buckets.size()] = static_cast<uint32_t>(applicable.size());
+    m_applicableStart = applicableStart;
+    m_applicable = applicable;
+}
+
+// --------------------------- Task Search ---------------------------
+
+// Arrays of an index built in memory; its views point here
+struct SearchArrays {
+    std::string           text;
+    std::vector<TextSpan> words;
+    std::vector<uint32_t> postingStart;
+    std::vector<uint32_t> postings;
+};
+
+void SearchIndex::Build(const TaskCatalog &catalog)
+{
+    TaskCatalog::Layout layout = catalog.Arrays();
+    std::unordered_map<std::string, uint32_t> wordIds;
+    std::vector<std::string_view>             wordNames; // by id (keys of wordIds)
+    auto wordId = [&](const std::string &word) {
+        auto it = wordIds.emplace(word, static_cast<uint32_t>(wordNames.size()));
+        if (it.second) wordNames.push_back(it.first->first);
+        return it.first->second;
+    };
+
+    // The words of each distinct text (arena span or part name) are found once
+    std::vector<uint32_t> wordLists;
+    std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> textWords;
+    std::vector<std::pair<uint32_t, uint32_t>> partWords;
+    auto collect = [&](std::string_view text) {
+        uint32_t begin = static_cast<uint32_t>(wordLists.size());
+        ForEachWord(text, true, [&](const std::string &word) { wordLists.push_back(wordId(word)); });
+        return std::make_pair(begin, static_cast<uint32_t>(wordLists.size()) - begin);
+    };
+    auto spanWords = [&](TextSpan span) {
+        uint64_t key = (static_cast<uint64_t>(span.offset) << 32) | span.length;
+        auto it = textWords.find(key);
+        if (it != textWords.end()) return it->second;
+        auto range = collect(layout.text.substr(span.offset, span.length));
+        textWords.emplace(key, range);
+        return range;
+    };
+    auto partWordRange = [&](PartId part) {
+        if (part >= partWords.size()) partWords.resize(part + 1, {0, UINT32_MAX});
+        if (partWords[part].second == UINT32_MAX) partWords[part] = collect(g_partRegistry.Name(part));
+        return partWords[part];
+    };
+
+    // (word, task) pairs, one per distinct word of a task
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    std::vector<uint32_t> taskWords;
+    Span<TaskRecord> tasks = layout.tasks;
+    for (uint32_t t = 0; t < tasks.size(); t++) {
+        const TaskRecord &r = tasks[t];
+        taskWords.clear();
+        auto add = [&](std::pair<uint32_t, uint32_t> range) {
+            taskWords.insert(taskWords.end(), wordLists.begin() + range.first,
+                             wordLists.begin() + range.first + range.second);
+        };
+        add(spanWords(r.name));
+        for (uint32_t i = 0; i < r.stepCount; i++) add(spanWords(layout.steps[r.firstStep + i]));
+        for (uint32_t i = 0; i < r.partCount; i++) add(partWordRange(layout.parts[r.firstPart + i].part));
+        std::sort(taskWords.begin(), taskWords.end());
+        taskWords.erase(std::unique(taskWords.begin(), taskWords.end()), taskWords.end());
+        for (uint32_t w : taskWords) pairs.push_back({w, t});
+    }
+
+    // Sorted vocabulary; rank[id] is a word's position in it
+    std::vector<uint32_t> order(wordNames.size());
+    for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(),
+              [&wordNames](uint32_t a, uint32_t b) { return wordNames[a] < wordNames[b]; });
+    std::vector<uint32_t> rank(order.size());
+    auto arrays = std::make_shared<SearchArrays>();
+    for (uint32_t i = 0; i < order.size(); i++) {
+        rank[order[i]] = i;
+        std::string_view word = wordNames[order[i]];
+        arrays->words.push_back({static_cast<uint32_t>(arrays->text.size()), static_cast<uint32_t>(word.size())});
+        arrays->text.append(word);
+    }
+
+    // Counting sort of the pairs by word; tasks were visited in order, so
+    // every posting list comes out ascending
+    std::vector<uint32_t> &start = arrays->postingStart;
+    start.assign(order.size() + 1, 0);
+    for (auto &p : pairs) start[rank[p.first] + 1]++;
+    for (size_t i = 1; i < start.size(); i++) start[i] += start[i - 1];
+    arrays->postings.resize(pairs.size());
+    std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+    for (auto &p : pairs) arrays->postings[fill[rank[p.first]]++] = p.second;
+
+    Layout built{arrays->text, arrays->words, arrays->postingStart, arrays->postings};
+    Attach(std::move(arrays), built, tasks.size());
+}
+
+void SearchIndex::Find(std::string_view query, std::vector<uint32_t> &result) const
+{
+    // Per-thread scratch: the query terms, and for every task the number of
+    // terms it has matched so far. A query sets back to 0 the entries it
+    // raised, so the counts are only zero-filled when the buffer grows.
+    thread_local std::vector<std::string> terms;
+    thread_local std::vector<uint8_t>     hits;
+    result.clear();
+    size_t count = 0;
+    ForEachWord(query, false, [&count](const std::string &word) {
+        if (count == terms.size()) terms.emplace_back();
+        terms[count++].assign(word);
+    });
+    if (count == 0 || count > 250) return;
+    if (hits.size() < m_taskCount) hits.resize(m_taskCount, 0);
+
+    // hits[t] == k: task t matched the first k terms. A term that advances
+    // no task ends the query without having raised any entry.
+    uint32_t first = 0, last = 0;
+    size_t matched = 0;
+    for (; matched < count; matched++) {
+        WordRange(terms[matched], first, last);
+        size_t advanced = 0;
+        for (uint32_t p = first; p < last; p++) {
+            uint8_t &h = hits[m_postings[p]];
+            if (h == matched) { h++; advanced++; }
+        }
+        if (advanced == 0) break;
+    }
+    if (matched == count) {
+        // The last term's postings hold every match (possibly several times)
+        uint8_t all = static_cast<uint8_t>(count);
+        for (uint32_t p = first; p < last; p++) {
+            uint8_t &h = hits[m_postings[p]];
+            if (h == all) {
+                h++;
+                result.push_back(m_postings[p]);
+            }
+        }
+        std::sort(result.begin(), result.end());
+    }
+    for (size_t k = 0; k < matched; k++) {
+        WordRange(terms[k], first, last);
+        for (uint32_t p = first; p < last; p++) hits[m_postings[p]] = 0;
+    }
+}
+
+// --------------------------- Stock Inventory ---------------------------
+
+// Global stock (parts never listed in stock.txt have quantity 0)
+StockInventory stockInventory;
+
+// Split 'text' on 'delim' the way repeated std::getline calls would: a trailing
+// delimiter does not produce an extra empty field. Up to maxFields fields are
+// stored in 'out'; the return value is the total number of fields found.
+static size_t SplitFields(std::string_view text, char delim, std::string_view *out, size_t maxFields)
+{
+    size_t count = 0;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find(delim, start);
+        if (end == std::string_view::npos) end = text.size();
+        if (count < maxFields) out[count] = text.substr(start, end - start);
+        count++;
+        start = end + 1;
+    }
+    return count;
+}
+
+// Call fn(item) for every non-empty comma-separated item of 'csv'
+template <typename Fn>
+static void ForEachCsvItem(std::string_view csv, Fn &&fn)
+{
+    size_t start = 0;
+    while (start < csv.size()) {
+        size_t end = csv.find(',', start);
+        if (end == std::string_view::npos) end = csv.size();
+        if (end > start) fn(csv.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+// Tasks parsed from one newline-aligned slice of tasks.txt. Parts are
+// numbered per chunk (index into partNames) so workers never touch the
+// global registry; system names and part names view the parsed buffer.
+struct TaskChunk
+{
+    CatalogBuilder                tasks;
+    std::vector<std::string_view> partNames; // chunk-local part ids
+};
+
+// Parse one slice; 'progress' gets the bytes consumed since its last call
+static void ParseTasksChunk(std::string_view data, TaskChunk &chunk,
+                            const std::function<void(size_t)> &progress)
+{
+    // Format per line: SystemName|TaskName|step1,step2,step3...|part1,part2*2,part3...[|type1,type2...]
+    std::unordered_map<std::string_view, PartId> partIndex;
+
+    size_t progressStep = std::max<size_t>(data.size() / 100, 1);
+    size_t reported = 0;
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t eol = data.find('\n', pos);
+        if (eol == std::string_view::npos) eol = data.size();
+        std::string_view line = data.substr(pos, eol - pos);
+        pos = std::min(eol + 1, data.size());
+        if (progress && pos - reported >= progressStep) {
+            progress(pos - reported);
+            reported = pos;
+        }
+        if (line.empty()) continue;
+
+        std::string_view fields[5];
+        size_t fieldCount = SplitFields(line, '|', fields, 5);
+        if (fieldCount < 4) {
+            LogWarning("Invalid task format: " + std::string(line));
+            continue;
+        }
+
+        chunk.tasks.BeginTask(fields[0], fields[1]);
+        ForEachCsvItem(fields[2], [&](std::string_view step) { chunk.tasks.AddStep(step); });
+        ForEachCsvItem(fields[3], [&](std::string_view part) {
+            // "Name" is one unit, "Name*N" is N units; repeats add up
+            int quantity = 1;
+            size_t star = part.rfind('*');
+            if (star != std::string_view::npos) {
+                std::string_view qty = part.substr(star + 1);
+                int parsed = 0;
+                auto res = std::from_chars(qty.data(), qty.data() + qty.size(), parsed);
+                if (res.ec == std::errc() && res.ptr == qty.data() + qty.size() && parsed > 0) {
+                    quantity = parsed;
+                    part = part.substr(0, star);
+                }
+            }
+            auto local = partIndex.emplace(part, static_cast<PartId>(chunk.partNames.size()));
+            if (local.second) chunk.partNames.push_back(part);
+            chunk.tasks.AddPart(local.first->second, quantity);
+        });
+        // Optional 5th field: aircraft types the card applies to
+        if (fieldCount >= 5) {
+            ForEachCsvItem(fields[4], [&](std::string_view type) { chunk.tasks.AddAircraftType(type); });
+        }
+    }
+    if (progress && pos > reported) progress(pos - reported);
+}
+
+// Append a parsed chunk to 'builder', mapping its local part numbers to
+// registry ids. Merging chunks in file order keeps every system's tasks in
+// line order and hands out part ids in the same order a serial parse would.
+static void MergeTaskChunk(const TaskChunk &chunk, CatalogBuilder &builder)
+{
+    std::vector<PartId> partIds;
+    partIds.reserve(chunk.partNames.size());
+    for (std::string_view name : chunk.partNames) partIds.push_back(g_partRegistry.Intern(name));
+    builder.Append(chunk.tasks, partIds);
+}
+
+// Catalogs smaller than this are parsed on the calling thread
+constexpr size_t kParallelParseMinBytes = 1 << 20;
+// Each worker gets at least this much input
+constexpr size_t kParallelParseChunkBytes = 256 << 10;
+
+// Parse tasks.txt contents into 'builder'.
+// Every line is scanned once for its '|' and ',' delimiters; the builder only
+// keeps views of the fields, so 'data' must outlive builder.Build(). Large inputs are cut into
+// newline-aligned chunks parsed on one thread per core and merged in order.
+// 'progress' (if set) is called about every percent of input, possibly from
+// worker threads.
+static void ParseTasksBuffer(std::string_view data, CatalogBuilder &builder,
+                             const LoadProgress &progress = LoadProgress())
+{
+    size_t workers = 1;
+    if (data.size() >= kParallelParseMinBytes) {
+        size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        workers = std::min(cores, data.size() / kParallelParseChunkBytes);
+    }
+
+    // Cut points: every chunk but the last ends just past a '\n'
+    std::vector<std::string_view> slices;
+    size_t start = 0;
+    for (size_t i = 1; i < workers && start < data.size(); ++i) {
+        size_t end = data.find('\n', std::max(start, data.size() * i / workers));
+        if (end == std::string_view::npos) break;
+        slices.push_back(data.substr(start, end + 1 - start));
+        start = end + 1;
+    }
+    if (start < data.size()) slices.push_back(data.substr(start));
+
+    std::atomic<size_t> done{0};
+    std::mutex progressMutex;
+    size_t progressStep = std::max<size_t>(data.size() / 100, 1);
+    size_t nextProgress = progressStep;
+    std::function<void(size_t)> onBytes;
+    if (progress) {
+        onBytes = [&](size_t bytes) {
+            size_t total = done.fetch_add(bytes) + bytes;
+            std::lock_guard<std::mutex> lock(progressMutex);
+            if (total < nextProgress) return;
+            nextProgress = total + progressStep;
+            progress(static_cast<double>(total) / data.size());
+        };
+    }
+
+    std::vector<TaskChunk> chunks(slices.size());
+    if (slices.size() <= 1) {
+        if (!slices.empty()) ParseTasksChunk(slices[0], chunks[0], onBytes);
+    } else {
+        std::vector<std::thread> threads;
+        threads.reserve(slices.size());
+        for (size_t i = 0; i < slices.size(); ++i) {
+            threads.emplace_back([&, i] { ParseTasksChunk(slices[i], chunks[i], onBytes); });
+        }
+        for (std::thread &t : threads) t.join();
+    }
+    for (const TaskChunk &chunk : chunks) MergeTaskChunk(chunk, builder);
+}
+
+// 1) Load tasks from a text file (memory-mapped, see ParseTasksBuffer)
+// and publish them, added to the current catalog, as a new snapshot
+bool LoadTasksFromFile(const std::string &filename) 
+{
+    ScopedTimer timer(Metric::CatalogLoad);
+    MappedFile file;
+    if (!file.Open(filename)) {
+        LogError("Failed to open tasks file: " + filename);
+        return false;
+    }
+    std::shared_ptr<const TaskCatalog> current = CatalogSnapshot();
+    CatalogBuilder builder;
+    builder.AddCatalog(*current);
+    ParseTasksBuffer(file.View(), builder);
+    std::shared_ptr<const TaskCatalog> catalog = builder.Build();
+    if (!catalog) {
+        LogError("Tasks file too large: " + filename);
+        return false;
+    }
+    PublishCatalog(std::move(catalog));
+    return true;
+}
+
+// Read stock.txt (part|quantity) into (PartId, quantity) pairs sorted by id;
+// a repeated part keeps the last quantity. Touches no global stock state.
+bool ReadStockFile(const std::string &filename, std::vector<std::pair<PartId, int>> &quantities)
+{
+    std::ifstream ifs(filename);
+    if (!ifs.is_open()) {
+        LogError("Failed to open stock file: " + filename);
+        return false;
+    }
+    std::map<PartId, int> byPart;
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (line.empty()) continue;
+        std::stringstream ss(line);
+        std::string partName;
+        std::string qtyStr;
+        if (!std::getline(ss, partName, '|')) {
+            LogWarning("Invalid stock format line: " + line);
+            continue;
+        }
+        if (!std::getline(ss, qtyStr, '|')) {
+            // might not have another '|'
+            LogWarning("Invalid stock format line (missing qty): " + line);
+            continue;
+        }
+        int quantity = 0;
+        try {
+            quantity = std::stoi(qtyStr);
+        } catch(...) {
+            LogWarning("Invalid quantity for part: " + qtyStr + " in line: " + line);
+            continue;
+        }
+        byPart[g_partRegistry.Intern(partName)] = quantity;
+    }
+    ifs.close();
+    quantities.assign(byPart.begin(), byPart.end());
+    return true;
+}
+
+// Rebuild stockParts (display order) from stockFileQuantities
+static void RebuildStockParts()
+{
+    stockParts.clear();
+    for (auto &q : stockFileQuantities) stockParts.push_back(q.first);
+    std::sort(stockParts.begin(), stockParts.end(), [](PartId a, PartId b) {
+        return g_partRegistry.Name(a) < g_partRegistry.Name(b);
+    });
+}
+
+// Read the fleet file: one aircraft per line, "Tail|Type" or just "Type".
+// Touches no global state.
+bool ReadFleetFile(const std::string &filename, std::vector<Aircraft> &fleet)
+{
+    std::ifstream ifs(filename);
+    if (!ifs.is_open()) return false;
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        std::string_view fields[2];
+        size_t count = SplitFields(line, '|', fields, 2);
+        Aircraft ac;
+        if (count >= 2) {
+            ac.tail.assign(fields[0]);
+            ac.type.assign(fields[1]);
+        } else {
+            ac.type.assign(fields[0]);
+        }
+        if (ac.Label().empty()) {
+            LogWarning("Invalid aircraft line: " + line);
+            continue;
+        }
+        fleet.push_back(std::move(ac));
+    }
+    return true;
+}
+
+// Replace the live stock with quantities read by ReadStockFile
+void ApplyStockFile(std::vector<std::pair<PartId, int>> &&quantities)
+{
+    // Start fresh
+    stockInventory.Reset(g_partRegistry.Size());
+    for (auto &q : quantities) {
+        stockInventory.SetQuantity(q.first, q.second);
+    }
+    stockFileQuantities = std::move(quantities);
+    RebuildStockParts();
+    g_stockLedger.RecordReset(stockFileQuantities);
+}
+
+// 2) Load stock from a text file (part|quantity), restoring the deductions
+//    its ledger recorded
+bool LoadStockFromFile(const std::string &filename)
+{
+    LoadedStock stock;
+    ReadStock(filename, stock);
+    return ApplyStock(std::move(stock));
+}
+
+// Merge a re-read stock.txt into the live stock: each part moves by the
+// difference between its new and previous file quantity, so deductions made
+// during the session are kept; parts dropped from the file go to zero.
+// The parts whose quantity changed are appended to 'changed'. Returns true if
+// the set of listed parts changed.
+bool MergeStockFile(std::vector<std::pair<PartId, int>> &&quantities, std::vector<PartId> &changed)
+{
+    bool partSetChanged = false;
+    std::vector<std::pair<PartId, int>> deltas;
+    auto adjust = [&](PartId part, int delta) {
+        stockInventory.Adjust(part, delta);
+        changed.push_back(part);
+        deltas.push_back({part, delta});
+    };
+    auto oldIt = stockFileQuantities.begin();
+    auto newIt = quantities.begin();
+    while (oldIt != stockFileQuantities.end() || newIt != quantities.end()) {
+        if (newIt == quantities.end() || (oldIt != stockFileQuantities.end() && oldIt->first < newIt->first)) {
+            adjust(oldIt->first, -stockInventory.Quantity(oldIt->first)); // removed from the file
+            partSetChanged = true;
+            ++oldIt;
+        } else if (oldIt == stockFileQuantities.end() || newIt->first < oldIt->first) {
+            adjust(newIt->first, newIt->second); // new in the file
+            partSetChanged = true;
+            ++newIt;
+        } else {
+            if (newIt->second != oldIt->second) {
+                adjust(newIt->first, newIt->second - oldIt->second);
+            }
+            ++oldIt;
+            ++newIt;
+        }
+    }
+    stockFileQuantities = std::move(quantities);
+    if (partSetChanged) RebuildStockParts();
+    if (!deltas.empty()) g_stockLedger.RecordRestock(std::move(deltas), stockFileQuantities);
+    return partSetChanged;
+}
+
+// --------------------------- Clock ---------------------------
+
+static const int64_t kClockRefreshSeconds = 3600; // longest a cached date is trusted
+
+static bool LocalTime(time_t t, tm &out)
+{
+#ifdef _WIN32
+    return localtime_s(&out, &t) == 0;
+#else
+    return localtime_r(&t, &out) != nullptr;
+#endif
+}
+
+// Days from 1970-01-01 to a proleptic Gregorian date (month 1..12)
+static int64_t DaysFromCivil(int64_t year, int month, int day)
+{
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t yearOfEra = year - era * 400;
+    int64_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+uint32_t ClockService::Today()
+{
+    int64_t now = static_cast<int64_t>(time(nullptr));
+    if (now < m_validUntil.load(std::memory_order_acquire)) return m_today.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    tm local;
+    if (!LocalTime(static_cast<time_t>(now), local)) return m_today.load(std::memory_order_relaxed);
+    uint32_t today = static_cast<uint32_t>((local.tm_year + 1900) * 10000 + (local.tm_mon + 1) * 100 + local.tm_mday);
+    int64_t untilMidnight = 86400 - (local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec);
+    m_today.store(today, std::memory_order_relaxed);
+    m_validUntil.store(now + std::min(untilMidnight, kClockRefreshSeconds), std::memory_order_release);
+    return today;
+}
+
+std::string ClockService::TodayText()
+{
+    return ReportDateText(Today());
+}
+
+std::string ClockService::Timestamp(time_t t)
+{
+    tm local;
+    if (!LocalTime(t, local)) return std::string();
+    // UTC offset: the local wall clock read as UTC, minus the real time
+    int64_t wall = DaysFromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday) * 86400 +
+                   local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec;
+    int64_t offset = (wall - static_cast<int64_t>(t)) / 60; // minutes
+    char sign = offset < 0 ? '-' : '+';
+    if (offset < 0) offset = -offset;
+    char buffer[96]; // room for any int fields, keeps -Wformat-truncation quiet
+    snprintf(buffer, sizeof(buffer), "%04d-%02d-%02dT%02d:%02d:%02d%c%02d:%02d",
+             local.tm_year + 1900, local.tm_mon + 1, local.tm_mday, local.tm_hour, local.tm_min,
+             local.tm_sec, sign, static_cast<int>(offset / 60), static_cast<int>(offset % 60));
+    return buffer;
+}
+
+ClockService g_clock;
+
+// --------------------------- Metrics ---------------------------
+// A sample is one 64-bit word, so a reader racing the writer sees either the
+// old or the new sample: allocations (24 bits) | nanoseconds (40 bits, about
+// 18 minutes), both saturating.
+
+static const unsigned kSampleAllocationBits = 24;
+static const unsigned kSampleDurationBits = 40;
+static const uint64_t kSampleAllocationMax = (uint64_t(1) << kSampleAllocationBits) - 1;
+static const uint64_t kSampleDurationMax = (uint64_t(1) << kSampleDurationBits) - 1;
+
+// Set during static initialization when mro_alloc_count.cpp is linked in
+static uint64_t (*g_allocationCounter)() = nullptr;
+
+void SetAllocationCounter(uint64_t (*counter)())
+{
+    g_allocationCounter = counter;
+}
+
+bool AllocationsCounted()
+{
+    return g_allocationCounter != nullptr;
+}
+
+uint64_t ThreadAllocations()
+{
+    return g_allocationCounter ? g_allocationCounter() : 0;
+}
+
+static const size_t kMetricCount = static_cast<size_t>(Metric::Count);
+
+// One thread's rings, one per metric
+struct MetricRing {
+    std::atomic<uint64_t> next[kMetricCount] = {}; // samples ever written
+    std::atomic<uint64_t> samples[kMetricCount][kMetricRingSize] = {};
+    std::atomic<bool>     owned{true};
+};
+
+// Rings are never freed: a thread that ends hands its rings (with their
+// samples) to the next new thread
+static std::mutex                               g_metricRingsMutex;
+static std::vector<std::unique_ptr<MetricRing>> g_metricRings;
+static std::atomic<uint64_t>                    g_metricCalls[kMetricCount];
+
+struct MetricRingOwner {
+    MetricRing *ring = nullptr;
+    ~MetricRingOwner()
+    {
+        if (ring) ring->owned.store(false, std::memory_order_release);
+    }
+};
+
+static thread_local MetricRingOwner t_metricRing;
+
+static MetricRing* ThreadMetricRing()
+{
+    if (t_metricRing.ring) return t_metricRing.ring;
+    std::lock_guard<std::mutex> lock(g_metricRingsMutex);
+    for (auto &ring : g_metricRings) {
+        if (!ring->owned.load(std::memory_order_acquire)) {
+            ring->owned.store(true, std::memory_order_relaxed);
+            return t_metricRing.ring = ring.get();
+        }
+    }
+    g_metricRings.push_back(std::make_unique<MetricRing>());
+    return t_metricRing.ring = g_metricRings.back().get();
+}
+
+const char* MetricName(Metric metric)
+{
+    static const char *const kNames[] = {
+        "catalog_load", "stock_load", "select_system", "select_task", "steps_dialog",
+        "stock_deduct", "report_format", "report_write", "report_sync",
+    };
+    size_t i = static_cast<size_t>(metric);
+    return i < sizeof(kNames) / sizeof(kNames[0]) ? kNames[i] : "?";
+}
+
+void RecordMetric(Metric metric, std::chrono::steady_clock::duration elapsed, uint64_t allocations)
+{
+    uint64_t ns = static_cast<uint64_t>(std::max<int64_t>(0,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    uint64_t sample = std::min(allocations, kSampleAllocationMax) << kSampleDurationBits |
+                      std::min(ns, kSampleDurationMax);
+    size_t m = static_cast<size_t>(metric);
+    MetricRing *ring = ThreadMetricRing();
+    uint64_t next = ring->next[m].load(std::memory_order_relaxed);
+    ring->samples[m][next % kMetricRingSize].store(sample, std::memory_order_relaxed);
+    ring->next[m].store(next + 1, std::memory_order_release);
+    g_metricCalls[m].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<MetricStats> CollectMetrics()
+{
+    std::vector<std::vector<uint64_t>> durations(kMetricCount);
+    std::vector<uint64_t> allocations(kMetricCount, 0);
+    {
+        std::lock_guard<std::mutex> lock(g_metricRingsMutex);
+        for (auto &ring : g_metricRings) {
+            for (size_t m = 0; m < kMetricCount; m++) {
+                uint64_t next = ring->next[m].load(std::memory_order_acquire);
+                uint64_t first = next > kMetricRingSize ? next - kMetricRingSize : 0;
+                for (uint64_t i = first; i < next; i++) {
+                    uint64_t sample = ring->samples[m][i % kMetricRingSize].load(std::memory_order_relaxed);
+                    durations[m].push_back(sample & kSampleDurationMax);
+                    allocations[m] += sample >> kSampleDurationBits;
+                }
+            }
+        }
+    }
+    std::vector<MetricStats> stats;
+    for (size_t m = 0; m < kMetricCount; m++) {
+        MetricStats s;
+        s.metric = static_cast<Metric>(m);
+        s.calls = g_metricCalls[m].load(std::memory_order_relaxed);
+        if (s.calls == 0) continue;
+        std::vector<uint64_t> &d = durations[m];
+        s.samples = d.size();
+        if (!d.empty()) {
+            std::sort(d.begin(), d.end());
+            auto us = [](uint64_t ns) { return ns / 1e3; };
+            s.p50Us = us(d[(d.size() - 1) / 2]);
+            s.p99Us = us(d[(d.size() - 1) * 99 / 100]);
+            s.maxUs = us(d.back());
+            s.allocationsPerCall = static_cast<double>(allocations[m]) / d.size();
+        }
+        stats.push_back(s);
+    }
+    return stats;
+}
+
+std::string FormatMetrics(const std::vector<MetricStats> &stats)
+{
+    std::string out = "metric               calls   recent     p50 us     p99 us     max us  allocs/call\n";
+    char line[160], allocs[32] = "-";
+    for (auto &s : stats) {
+        if (AllocationsCounted()) snprintf(allocs, sizeof(allocs), "%.1f", s.allocationsPerCall);
+        snprintf(line, sizeof(line), "%-14s %11llu %8zu %10.1f %10.1f %10.1f %12s\n", MetricName(s.metric),
+                 static_cast<unsigned long long>(s.calls), s.samples, s.p50Us, s.p99Us, s.maxUs, allocs);
+        out += line;
+    }
+    return out;
+}
+
+// Periodic dump thread
+static std::mutex              g_metricsDumpMutex;
+static std::condition_variable g_metricsDumpWake;
+static std::thread             g_metricsDumpThread;
+static bool                    g_metricsDumpRunning = false;
+
+static void DumpMetrics(const std::string &filename)
+{
+    std::ofstream ofs(filename, std::ios::app);
+    ofs << "=== " << g_clock.Now() << " ===\n" << FormatMetrics(CollectMetrics()) << "\n";
+}
+
+bool StartMetricsDump(const std::string &filename, int intervalSeconds)
+{
+    std::lock_guard<std::mutex> lock(g_metricsDumpMutex);
+    if (g_metricsDumpRunning || intervalSeconds <= 0) return false;
+    if (!std::ofstream(filename, std::ios::app)) {
+        LogWarning("Could not open " + filename + " for the metrics dump");
+        return false;
+    }
+    g_metricsDumpRunning = true;
+    g_metricsDumpThread = std::thread([filename, intervalSeconds] {
+        std::unique_lock<std::mutex> lock(g_metricsDumpMutex);
+        while (g_metricsDumpRunning) {
+            g_metricsDumpWake.wait_for(lock, std::chrono::seconds(intervalSeconds),
+                                       [] { return !g_metricsDumpRunning; });
+            lock.unlock();
+            DumpMetrics(filename);
+            lock.lock();
+        }
+    });
+    return true;
+}
+
+void StopMetricsDump()
+{
+    {
+        std::lock_guard<std::mutex> lock(g_metricsDumpMutex);
+        if (!g_metricsDumpRunning) return;
+        g_metricsDumpRunning = false;
+    }
+    g_metricsDumpWake.notify_all();
+    g_metricsDumpThread.join();
+}
+
+// --------------------------- Binary Catalog Cache ---------------------------
+// A compiled copy of tasks.txt ("tasks.txt.cat") that is mapped and used in
+// place: the sections are the TaskCatalog arrays, including the search and
+// applicability indexes, so loading neither parses nor copies anything.
+// Layout:
+//   CatalogHeader
+//   SystemRecord[systemCount]           tasks of one system are contiguous
+//   TaskRecord[taskCount]
+//   TextSpan[stepCount]                 step text
+//   TextSpan[typeRefCount]              aircraft types of each task
+//   PartDemand[partRefCount]            required parts, as PartIds of the writer
+//   TextSpan[partNameCount]             part names, by those PartIds
+//   TextSpan[aircraftTypeCount]         applicability index
+//   uint32_t[(aircraftTypeCount + 1) * systemCount + 1]
+//   uint32_t[applicableCount]
+//   TextSpan[wordCount]                 search index words
+//   uint32_t[wordCount + 1]             posting list starts
+//   uint32_t[postingCount]
+//   char[blobSize]                      catalog text arena followed by the part names
+//   char[wordTextSize]                  search index words
+// The cache is used while it was built from the same tasks.txt: size and
+// modification time are a quick pre-check, a hash of its contents decides.
+// The header carries its own checksum and one over everything after it, so
+// a damaged cache is rebuilt rather than indexed out of range.
+
+static const char     kCatalogMagic[8] = {'M', 'R', 'O', 'C', 'A', 'T', '\0', '\0'};
+static const uint32_t kCatalogVersion  = 5;
+
+struct CatalogHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t systemCount;
+    uint32_t taskCount;
+    uint32_t stepCount;
+    uint32_t typeRefCount;
+    uint32_t partRefCount;
+    uint32_t partNameCount;
+    uint32_t aircraftTypeCount;
+    uint32_t applicableCount;
+    uint32_t wordCount;
+    uint32_t postingCount;
+    uint32_t reserved;       // keeps the 64-bit fields aligned
+    uint64_t blobSize;
+    uint64_t wordTextSize;
+    uint64_t sourceSize;
+    int64_t  sourceModified;
+    uint64_t sourceHash;      // HashWords of tasks.txt
+    uint64_t payloadChecksum; // HashWords of the sections
+    uint64_t headerChecksum;  // FNV-1a of the header with this field zeroed
+};
+
+// The sections are used as the in-memory arrays
+static_assert(sizeof(CatalogHeader) % alignof(TaskRecord) == 0, "catalog sections must stay aligned");
+static_assert(alignof(PartDemand) == alignof(TextSpan), "catalog sections must stay aligned");
+
+// 64-bit FNV-1a
+static uint64_t HashBytes(std::string_view bytes, uint64_t hash = 14695981039346656037ULL)
+{
+    for (unsigned char c : bytes) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// FNV-1a over 64-bit words, then the remaining bytes: for whole files, fed
+// in pieces of any size. Each step is a bijection of the state, so a change
+// in any one word changes the hash.
+class WordHasher
+{
+public:
+    void Add(std::string_view bytes)
+    {
+        if (m_carried) {
+            size_t n = std::min(bytes.size(), sizeof(m_carry) - m_carried);
+            std::memcpy(m_carry + m_carried, bytes.data(), n);
+            m_carried += n;
+            bytes.remove_prefix(n);
+            if (m_carried < sizeof(m_carry)) return;
+            Word(m_carry);
+            m_carried = 0;
+        }
+        for (; bytes.size() >= sizeof(m_carry); bytes.remove_prefix(sizeof(m_carry))) Word(bytes.data());
+        if (!bytes.empty()) std::memcpy(m_carry, bytes.data(), bytes.size());
+        m_carried = bytes.size();
+    }
+
+    uint64_t Finish() const { return HashBytes(std::string_view(m_carry, m_carried), m_hash); }
+
+private:
+    uint64_t m_hash = 14695981039346656037ULL;
+    char     m_carry[sizeof(uint64_t)];
+    size_t   m_carried = 0;
+
+    void Word(const char *bytes)
+    {
+        uint64_t word;
+        std::memcpy(&word, bytes, sizeof(word));
+        m_hash ^= word;
+        m_hash *= 1099511628211ULL;
+    }
+};
+
+static uint64_t HashWords(std::string_view bytes)
+{
+    WordHasher hasher;
+    hasher.Add(bytes);
+    return hasher.Finish();
+}
+
+uint64_t CatalogSourceHash(std::string_view text)
+{
+    return HashWords(text);
+}
+
+static uint64_t HeaderChecksum(CatalogHeader header)
+{
+    header.headerChecksum = 0;
+    return HashBytes(std::string_view(reinterpret_cast<const char*>(&header), sizeof(header)));
+}
+
+// Typed view of one array section of a mapped catalog
+template <typename T>
+static Span<T> CatalogSection(std::string_view file, size_t &offset, uint64_t count, bool &ok)
+{
+    if (!ok || count > (file.size() - offset) / sizeof(T)) {
+        ok = false;
+        return Span<T>();
+    }
+    const T *section = reinterpret_cast<const T*>(file.data() + offset);
+    offset += count * sizeof(T);
+    return Span<T>(section, static_cast<size_t>(count));
+}
+
+bool GetFileStamp(const std::string &filename, FileStamp &stamp)
+{
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(filename, error);
+    if (error) return false;
+    std::filesystem::file_time_type modified = std::filesystem::last_write_time(filename, error);
+    if (error) return false;
+    stamp.size = size;
+    stamp.modified = static_cast<int64_t>(modified.time_since_epoch().count());
+    return true;
+}
+
+// Write 'catalog' (and the part names it references) as a catalog cache.
+// The file is written under a temporary name and renamed into place, so a
+// reader never sees a half-written cache.
+bool WriteCatalogCache(const std::string &cacheFile, const TaskCatalog &catalog, const FileStamp &source,
+                       uint64_t sourceHash)
+{
+    TaskCatalog::Layout layout = catalog.Arrays();
+    std::vector<TextSpan> partNames;
+    std::string           blob(layout.text);
+    for (PartId id = 0; id < g_partRegistry.Size(); id++) {
+        const std::string &name = g_partRegistry.Name(id);
+        partNames.push_back({static_cast<uint32_t>(blob.size()), static_cast<uint32_t>(name.size())});
+        blob.append(name);
+    }
+    if (blob.size() > std::numeric_limits<uint32_t>::max()) return false;
+
+    CatalogHeader header{};
+    std::memcpy(header.magic, kCatalogMagic, sizeof(header.magic));
+    header.version           = kCatalogVersion;
+    header.systemCount       = static_cast<uint32_t>(layout.systems.size());
+    header.taskCount         = static_cast<uint32_t>(layout.tasks.size());
+    header.stepCount         = static_cast<uint32_t>(layout.steps.size());
+    header.typeRefCount      = static_cast<uint32_t>(layout.types.size());
+    header.partRefCount      = static_cast<uint32_t>(layout.parts.size());
+    header.partNameCount     = static_cast<uint32_t>(partNames.size());
+    header.aircraftTypeCount = static_cast<uint32_t>(layout.aircraftTypes.size());
+    header.applicableCount   = static_cast<uint32_t>(layout.applicable.size());
+    header.wordCount         = static_cast<uint32_t>(layout.search.words.size());
+    header.postingCount      = static_cast<uint32_t>(layout.search.postings.size());
+    header.blobSize          = blob.size();
+    header.wordTextSize      = layout.search.text.size();
+    header.sourceSize        = source.size;
+    header.sourceModified    = source.modified;
+    header.sourceHash        = sourceHash;
+
+    std::string tmpFile = cacheFile + ".tmp";
+    {
+        std::ofstream ofs(tmpFile, std::ios::binary | std::ios::trunc);
+        if (!ofs) return false;
+        WordHasher payload;
+        auto write = [&ofs, &payload](const void *data, size_t bytes) {
+            payload.Add(std::string_view(static_cast<const char*>(data), bytes));
+            ofs.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        };
+        auto writeArray = [&write](const auto &span) { write(span.data(), span.size() * sizeof(span[0])); };
+        // The header goes in last, once the sections' checksum is known
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writeArray(layout.systems);
+        writeArray(layout.tasks);
+        writeArray(layout.steps);
+        writeArray(layout.types);
+        writeArray(layout.parts);
+        writeArray(Span<TextSpan>(partNames));
+        writeArray(layout.aircraftTypes);
+        writeArray(layout.applicableStart);
+        writeArray(layout.applicable);
+        writeArray(layout.search.words);
+        writeArray(layout.search.postingStart);
+        writeArray(layout.search.postings);
+        write(blob.data(), blob.size());
+        write(layout.search.text.data(), layout.search.text.size());
+        header.payloadChecksum = payload.Finish();
+        header.headerChecksum  = HeaderChecksum(header);
+        ofs.seekp(0);
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (!ofs) {
+            ofs.close();
+            std::remove(tmpFile.c_str());
+            return false;
+        }
+    }
+    return RenameOver(tmpFile, cacheFile);
+}
+
+// A catalog loaded from the cache: the mapping its views point into, plus
+// its parts when the PartIds of this process differ from the writer's
+struct CachedCatalog {
+    MappedFile              file;
+    std::vector<PartDemand> parts;
+};
+
+// Load a catalog cache. Returns null if the cache is missing, damaged, from
+// another version, or was built from another version of tasks.txt.
+std::shared_ptr<const TaskCatalog> LoadCatalogCache(const std::string &cacheFile, const FileStamp &source,
+                                                    std::string_view sourceText)
+{
+    auto storage = std::make_shared<CachedCatalog>();
+    if (!storage->file.Open(cacheFile)) return nullptr;
+    std::string_view bytes = storage->file.View();
+    if (bytes.size() < sizeof(CatalogHeader)) return nullptr;
+
+    CatalogHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, kCatalogMagic, sizeof(header.magic)) != 0 ||
+        header.version != kCatalogVersion || header.headerChecksum != HeaderChecksum(header) ||
+        header.sourceSize != source.size || header.sourceModified != source.modified ||
+        header.payloadChecksum != HashWords(bytes.substr(sizeof(header))) ||
+        header.sourceHash != CatalogSourceHash(sourceText)) {
+        return nullptr;
+    }
+
+    bool ok = true;
+    size_t offset = sizeof(header);
+    uint64_t buckets = (uint64_t(header.aircraftTypeCount) + 1) * header.systemCount + 1;
+    TaskCatalog::Layout layout;
+    layout.systems         = CatalogSection<SystemRecord>(bytes, offset, header.systemCount, ok);
+    layout.tasks           = CatalogSection<TaskRecord>(bytes, offset, header.taskCount, ok);
+    layout.steps           = CatalogSection<TextSpan>(bytes, offset, header.stepCount, ok);
+    layout.types           = CatalogSection<TextSpan>(bytes, offset, header.typeRefCount, ok);
+    layout.parts           = CatalogSection<PartDemand>(bytes, offset, header.partRefCount, ok);
+    auto partNames         = CatalogSection<TextSpan>(bytes, offset, header.partNameCount, ok);
+    layout.aircraftTypes   = CatalogSection<TextSpan>(bytes, offset, header.aircraftTypeCount, ok);
+    layout.applicableStart = CatalogSection<uint32_t>(bytes, offset, buckets, ok);
+    layout.applicable      = CatalogSection<uint32_t>(bytes, offset, header.applicableCount, ok);
+    layout.search.words    = CatalogSection<TextSpan>(bytes, offset, header.wordCount, ok);
+    layout.search.postingStart = CatalogSection<uint32_t>(bytes, offset, uint64_t(header.wordCount) + 1, ok);
+    layout.search.postings = CatalogSection<uint32_t>(bytes, offset, header.postingCount, ok);
+    auto blob              = CatalogSection<char>(bytes, offset, header.blobSize, ok);
+    auto wordText          = CatalogSection<char>(bytes, offset, header.wordTextSize, ok);
+    if (!ok || offset != bytes.size()) return nullptr;
+    layout.text = std::string_view(blob.data(), blob.size());
+    layout.search.text = std::string_view(wordText.data(), wordText.size());
+
+    // The checksum rules out damage; these keep a cache that does not hold
+    // the writer's invariants from reaching the lookups that rely on them
+    auto validString = [&](const TextSpan &ref) {
+        return ref.offset <= layout.text.size() && ref.length <= layout.text.size() - ref.offset;
+    };
+    auto str = [&](const TextSpan &ref) { return layout.text.substr(ref.offset, ref.length); };
+    uint32_t nextTask = 0;
+    for (size_t s = 0; s < layout.systems.size(); s++) {
+        const SystemRecord &sys = layout.systems[s];
+        if (!validString(sys.name) || sys.firstTask != nextTask || sys.taskCount > header.taskCount - nextTask) {
+            return nullptr;
+        }
+        // TaskCatalog::FindSystem() relies on the name order
+        if (s > 0 && !(str(layout.systems[s - 1].name) < str(sys.name))) return nullptr;
+        nextTask += sys.taskCount;
+    }
+    if (nextTask != header.taskCount) return nullptr;
+    for (size_t b = 1; b < layout.applicableStart.size(); b++) {
+        if (layout.applicableStart[b] < layout.applicableStart[b - 1]) return nullptr;
+    }
+    if (layout.applicableStart[0] != 0 || layout.applicableStart[buckets - 1] != header.applicableCount) {
+        return nullptr;
+    }
+    if (layout.search.postingStart[header.wordCount] != header.postingCount) return nullptr;
+
+    // Part names -> PartIds of this process. They usually come out the same
+    // as the writer's, and the parts are used in place; otherwise they are
+    // copied with the ids of this process.
+    std::vector<PartId> partMap(partNames.size());
+    bool samePartIds = true;
+    for (size_t i = 0; i < partNames.size(); i++) {
+        if (!validString(partNames[i])) return nullptr;
+        partMap[i] = g_partRegistry.Intern(str(partNames[i]));
+        samePartIds = samePartIds && partMap[i] == i;
+    }
+    for (const PartDemand &d : layout.parts) {
+        if (d.part >= partMap.size() || d.quantity <= 0) return nullptr;
+    }
+    if (!samePartIds) {
+        storage->parts.reserve(layout.parts.size());
+        for (const PartDemand &d : layout.parts) storage->parts.push_back({partMap[d.part], d.quantity});
+        layout.parts = storage->parts;
+    }
+    return std::make_shared<const TaskCatalog>(std::move(storage), layout);
+}
+
+// Read tasks through the catalog cache: use "<filename>.cat" when it was
+// built from the current file, otherwise parse the text file and (re)write
+// the cache for the next start. Returns null on failure. Safe to call from
+// a background thread.
+std::shared_ptr<const TaskCatalog> ReadCatalog(const std::string &filename, const LoadProgress &progress)
+{
+    ScopedTimer timer(Metric::CatalogLoad);
+    // The stamp is taken before the file is read: a change made while it is
+    // parsed gives the file a newer stamp than the cache
+    FileStamp stamp;
+    std::string cacheFile = filename + ".cat";
+    bool stamped = GetFileStamp(filename, stamp);
+    MappedFile file;
+    if (!file.Open(filename)) {
+        LogError("Failed to open tasks file: " + filename);
+        return nullptr;
+    }
+    if (stamped) {
+        if (auto cached = LoadCatalogCache(cacheFile, stamp, file.View())) return cached;
+    }
+    CatalogBuilder builder;
+    ParseTasksBuffer(file.View(), builder, progress);
+    std::shared_ptr<const TaskCatalog> catalog = builder.Build();
+    if (!catalog) {
+        LogError("Tasks file too large: " + filename);
+        return nullptr;
+    }
+    if (!WriteCatalogCache(cacheFile, *catalog, stamp, CatalogSourceHash(file.View()))) {
+        LogWarning("Could not write catalog cache: " + cacheFile);
+    }
+    return catalog;
+}
+
+// Read the catalog (see ReadCatalog) and publish it as the current snapshot
+bool LoadCatalog(const std::string &filename)
+{
+    std::shared_ptr<const TaskCatalog> catalog = ReadCatalog(filename);
+    if (!catalog) return false;
+    PublishCatalog(std::move(catalog));
+    return true;
+}
+
+// Build the catalog cache for 'filename' without starting the GUI
+// ("--compile-catalog [tasks.txt]")
+bool CompileCatalog(const std::string &filename)
+{
+    FileStamp stamp;
+    MappedFile file;
+    if (!GetFileStamp(filename, stamp) || !file.Open(filename)) {
+        fprintf(stderr, "Failed to open tasks file: %s\n", filename.c_str());
+        return false;
+    }
+    CatalogBuilder builder;
+    ParseTasksBuffer(file.View(), builder);
+    std::shared_ptr<const TaskCatalog> catalog = builder.Build();
+    std::string cacheFile = filename + ".cat";
+    if (!catalog || !WriteCatalogCache(cacheFile, *catalog, stamp, CatalogSourceHash(file.View()))) {
+        fprintf(stderr, "Failed to write catalog cache: %s\n", cacheFile.c_str());
+        return false;
+    }
+    printf("Compiled %s -> %s\n", filename.c_str(), cacheFile.c_str());
+    return true;
+}
+
+// --------------------------- Catalog Diff ---------------------------
+
+static bool SameTasks(const TaskCatalog::TaskList &a, const TaskCatalog::TaskList &b)
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (!(a[i] == b[i])) return false;
+    }
+    return true;
+}
+
+// Compare two catalogs system by system; tasks are matched by name
+CatalogDiff DiffCatalogs(const TaskCatalog &before, const TaskCatalog &after)
+{
+    CatalogDiff diff;
+    std::vector<std::string_view> systems;
+    for (size_t s = 0; s < before.SystemCount(); s++) systems.push_back(before.SystemName(s));
+    for (size_t s = 0; s < after.SystemCount(); s++) {
+        if (before.FindSystem(after.SystemName(s)) == TaskCatalog::npos) systems.push_back(after.SystemName(s));
+    }
+    for (std::string_view name : systems) {
+        TaskCatalog::TaskList oldTasks = before.Find(name);
+        TaskCatalog::TaskList newTasks = after.Find(name);
+        if (SameTasks(oldTasks, newTasks)) continue;
+        diff.changedSystems.emplace_back(name);
+
+        std::unordered_map<std::string_view, Task> oldByName;
+        for (Task t : oldTasks) oldByName.emplace(t.name, t);
+        for (Task t : newTasks) {
+            auto it = oldByName.find(t.name);
+            if (it == oldByName.end()) {
+                diff.addedTasks++;
+                continue;
+            }
+            if (!(it->second == t)) diff.changedTasks++;
+            oldByName.erase(it);
+        }
+        diff.removedTasks += oldByName.size();
+    }
+    return diff;
+}
+
+// --------------------------- ReportWriter ---------------------------
+
+ReportWriter g_reportWriter;
+
+void ReportWriter::Sync()
+{
+    for (FILE *file : m_files) {
+        if (file) SyncFile(file);
+    }
+}
+
+// --------------------------- Report Journal ---------------------------
+// Both files are a JournalFileHeader followed by entries, each a
+// JournalEntryHeader and its payload:
+//   journal  name entry:   name chars
+//            report entry: JournalReport, JournalPart[partCount]
+//   index    name entry:   uint64 journal offset of the name, name chars
+//            report entry: JournalIndexEntry
+// Name ids number the name entries in file order. The index lists the
+// journal's entries in the same order; on open it is checked against the
+// journal, the journal entries it lacks are added and a torn entry at the
+// end of the journal is cut off.
+
+static const char     kJournalMagic[8]      = {'M', 'R', 'O', 'J', 'R', 'N', 'L', '\0'};
+static const char     kJournalIndexMagic[8] = {'M', 'R', 'O', 'J', 'I', 'D', 'X', '\0'};
+static const uint32_t kJournalVersion       = 1;
+
+struct JournalFileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+enum JournalEntryKind : uint32_t { kJournalName = 1, kJournalReport = 2 };
+
+struct JournalEntryHeader {
+    uint32_t kind;
+    uint32_t size;     // payload bytes
+    uint32_t checksum; // low half of the payload's FNV-1a
+};
+
+struct JournalReport {
+    uint32_t id;
+    uint32_t date;     // yyyymmdd
+    uint32_t aircraft; // name ids
+    uint32_t system;
+    uint32_t task;
+    uint32_t partCount;
+};
+
+struct JournalPart { uint32_t part, quantity; }; // part is a name id
+
+// Append one entry to 'out'; returns its size
+static uint32_t AppendJournalEntry(std::string &out, uint32_t kind, std::string_view payload)
+{
+    JournalEntryHeader header{kind, static_cast<uint32_t>(payload.size()),
+                              static_cast<uint32_t>(HashBytes(payload))};
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.append(payload);
+    return static_cast<uint32_t>(sizeof(header) + payload.size());
+}
+
+// Entry at 'offset' of 'bytes'; false if it is cut off or corrupt
+static bool ReadJournalEntry(std::string_view bytes, uint64_t offset, JournalEntryHeader &header,
+                             std::string_view &payload)
+{
+    if (bytes.size() - offset < sizeof(header)) return false;
+    std::memcpy(&header, bytes.data() + offset, sizeof(header));
+    if (bytes.size() - offset - sizeof(header) < header.size) return false;
+    payload = bytes.substr(static_cast<size_t>(offset + sizeof(header)), header.size);
+    return static_cast<uint32_t>(HashBytes(payload)) == header.checksum;
+}
+
+// Make room for 'bytes' more in 'out'. Capacity at least doubles, so a
+// buffer reused across reports settles at its working size.
+static void ReserveMore(std::string &out, size_t bytes)
+{
+    size_t need = out.size() + bytes;
+    if (need > out.capacity()) out.reserve(std::max(need, out.capacity() * 2));
+}
+
+static void AppendNumber(std::string &out, long long value)
+{
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+static void AppendReportId(std::string &out, uint32_t id)
+{
+    out += "RPT-";
+    AppendNumber(out, id);
+}
+
+// yyyymmdd as "YYYY-MM-DD"
+static void AppendReportDate(std::string &out, uint32_t date)
+{
+    char buffer[10];
+    uint32_t year = date / 10000 % 10000, month = date / 100 % 100, day = date % 100;
+    buffer[0] = static_cast<char>('0' + year / 1000);
+    buffer[1] = static_cast<char>('0' + year / 100 % 10);
+    buffer[2] = static_cast<char>('0' + year / 10 % 10);
+    buffer[3] = static_cast<char>('0' + year % 10);
+    buffer[4] = '-';
+    buffer[5] = static_cast<char>('0' + month / 10);
+    buffer[6] = static_cast<char>('0' + month % 10);
+    buffer[7] = '-';
+    buffer[8] = static_cast<char>('0' + day / 10);
+    buffer[9] = static_cast<char>('0' + day % 10);
+    out.append(buffer, sizeof(buffer));
+}
+
+// "Part" for one unit, "Part x3" otherwise (PartLabel)
+static void AppendPartLabel(std::string &out, const std::string &name, int quantity)
+{
+    out += name;
+    if (quantity != 1) {
+        out += " x";
+        AppendNumber(out, quantity);
+    }
+}
+
+std::string ReportIdText(uint32_t id)
+{
+    std::string text;
+    AppendReportId(text, id);
+    return text;
+}
+
+// "YYYY-MM-DD" as yyyymmdd; 0 if the text is not such a date
+uint32_t ParseReportDate(std::string_view text)
+{
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-') return 0;
+    auto number = [text](size_t pos, size_t len, uint32_t &out) {
+        auto result = std::from_chars(text.data() + pos, text.data() + pos + len, out);
+        return result.ec == std::errc() && result.ptr == text.data() + pos + len;
+    };
+    uint32_t year, month, day;
+    if (!number(0, 4, year) || !number(5, 2, month) || !number(8, 2, day) ||
+        month < 1 || month > 12 || day < 1 || day > 31) {
+        return 0;
+    }
+    return year * 10000 + month * 100 + day;
+}
+
+std::string ReportDateText(uint32_t date)
+{
+    std::string text;
+    AppendReportDate(text, date);
+    return text;
+}
+
+bool ParseReportFormat(std::string_view name, ReportFormat &format)
+{
+    if (name == "text") format = ReportFormat::Text;
+    else if (name == "csv") format = ReportFormat::Csv;
+    else if (name == "jsonl") format = ReportFormat::JsonLines;
+    else return false;
+    return true;
+}
+
+// Bytes of 'report' in any format, except for escapes and part quantities
+static size_t ReportTextBytes(const MaintenanceReport &report)
+{
+    size_t bytes = 160 + report.aircraft.size() + report.system.size() + report.task.size();
+    for (auto &p : report.parts) bytes += p.first.size() + 32;
+    return bytes;
+}
+
+void RenderReportText(const MaintenanceReport &report, std::string &out)
+{
+    ReserveMore(out, ReportTextBytes(report));
+    out += "=== Maintenance Report ===\nReport ID: ";
+    AppendReportId(out, report.id);
+    out += "\nDate: ";
+    AppendReportDate(out, report.date);
+    if (!report.aircraft.empty()) {
+        out += "\nAircraft: ";
+        out += report.aircraft;
+    }
+    out += "\nSystem: ";
+    out += report.system;
+    out += "\nCompleted Task: ";
+    out += report.task;
+    out += "\nUsed Parts:\n";
+    for (auto &p : report.parts) {
+        out += "  - ";
+        AppendPartLabel(out, p.first, p.second);
+        out += '\n';
+    }
+    out += "==========================\n\n";
+}
+
+static bool CsvNeedsQuotes(std::string_view field)
+{
+    return field.find_first_of(",\"\r\n") != std::string_view::npos;
+}
+
+// 'text' inside a quoted CSV field: quotes doubled
+static void AppendCsvQuoted(std::string &out, std::string_view text)
+{
+    for (size_t pos = 0;;) {
+        size_t quote = text.find('"', pos);
+        out += text.substr(pos, quote - pos);
+        if (quote == std::string_view::npos) break;
+        out += "\"\"";
+        pos = quote + 1;
+    }
+}
+
+// One CSV field, quoted when it holds a separator, quote or line break
+static void AppendCsvField(std::string &out, std::string_view field)
+{
+    if (!CsvNeedsQuotes(field)) {
+        out += field;
+        return;
+    }
+    out += '"';
+    AppendCsvQuoted(out, field);
+    out += '"';
+}
+
+// One JSON string, quotes included
+static void AppendJsonString(std::string &out, std::string_view text)
+{
+    static const char kHex[] = "0123456789abcdef";
+    out += '"';
+    size_t run = 0; // start of the bytes not copied yet
+    for (size_t i = 0; i < text.size(); i++) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        out += text.substr(run, i - run);
+        run = i + 1;
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default: {
+                char escape[6] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 15]};
+                out.append(escape, sizeof(escape));
+            }
+        }
+    }
+    out += text.substr(run);
+    out += '"';
+}
+
+static void RenderReportCsv(const MaintenanceReport &report, std::string &out)
+{
+    ReserveMore(out, ReportTextBytes(report));
+    AppendReportId(out, report.id);
+    out += ',';
+    AppendReportDate(out, report.date);
+    out += ',';
+    AppendCsvField(out, report.aircraft);
+    out += ',';
+    AppendCsvField(out, report.system);
+    out += ',';
+    AppendCsvField(out, report.task);
+    out += ',';
+    // The parts column reads like the report log's "Used Parts"
+    bool quoted = report.parts.size() > 1;
+    for (auto &p : report.parts) quoted = quoted || CsvNeedsQuotes(p.first);
+    if (quoted) out += '"';
+    for (size_t i = 0; i < report.parts.size(); i++) {
+        if (i) out += ", ";
+        if (quoted) AppendCsvQuoted(out, report.parts[i].first);
+        else out += report.parts[i].first;
+        if (report.parts[i].second != 1) {
+            out += " x";
+            AppendNumber(out, report.parts[i].second);
+        }
+    }
+    if (quoted) out += '"';
+    out += "\r\n";
+}
+
+static void RenderReportJson(const MaintenanceReport &report, std::string &out)
+{
+    ReserveMore(out, ReportTextBytes(report));
+    out += "{\"id\":\"";
+    AppendReportId(out, report.id);
+    out += "\",\"date\":\"";
+    AppendReportDate(out, report.date);
+    out += "\",\"aircraft\":";
+    AppendJsonString(out, report.aircraft);
+    out += ",\"system\":";
+    AppendJsonString(out, report.system);
+    out += ",\"task\":";
+    AppendJsonString(out, report.task);
+    out += ",\"parts\":[";
+    for (size_t i = 0; i < report.parts.size(); i++) {
+        if (i) out += ',';
+        out += "{\"name\":";
+        AppendJsonString(out, report.parts[i].first);
+        out += ",\"quantity\":";
+        AppendNumber(out, report.parts[i].second);
+        out += '}';
+    }
+    out += "]}\n";
+}
+
+void RenderReport(const MaintenanceReport &report, ReportFormat format, std::string &out)
+{
+    switch (format) {
+        case ReportFormat::Text:      RenderReportText(report, out); break;
+        case ReportFormat::Csv:       RenderReportCsv(report, out); break;
+        case ReportFormat::JsonLines: RenderReportJson(report, out); break;
+    }
+}
+
+void RenderReportHeader(ReportFormat format, std::string &out)
+{
+    if (format == ReportFormat::Csv) out += "Report ID,Date,Aircraft,System,Completed Task,Used Parts\r\n";
+}
+
+ReportRecord SummarizeReport(const MaintenanceReport &report)
+{
+    ReportRecord rec{ReportIdText(report.id), ReportDateText(report.date),
+                     report.aircraft, report.system, report.task, ""};
+    for (auto &p : report.parts) {
+        if (!rec.parts.empty()) rec.parts += ", ";
+        AppendPartLabel(rec.parts, p.first, p.second);
+    }
+    return rec;
+}
+
+void ReportJournal::Record(const MaintenanceReport &report, ReportBatch &batch)
+{
+    if (!m_open) return;
+    JournalReport rec{report.id, report.date, Intern(report.aircraft, batch),
+                      Intern(report.system, batch), Intern(report.task, batch),
+                      static_cast<uint32_t>(report.parts.size())};
+    m_payload.assign(reinterpret_cast<const char*>(&rec), sizeof(rec));
+    for (auto &p : report.parts) {
+        JournalPart part{Intern(p.first, batch), static_cast<uint32_t>(p.second)};
+        m_payload.append(reinterpret_cast<const char*>(&part), sizeof(part));
+    }
+    JournalIndexEntry entry{rec.date, rec.aircraft, rec.system, rec.task, rec.id, 0, m_journalSize};
+    entry.recordSize = AppendJournalEntry(batch.journal, kJournalReport, m_payload);
+    m_journalSize += entry.recordSize;
+    AppendJournalEntry(batch.index, kJournalReport,
+                std::string_view(reinterpret_cast<const char*>(&entry), sizeof(entry)));
+    m_entries.push_back(entry);
+}
+
+uint32_t ReportJournal::Intern(const std::string &name, ReportBatch &batch)
+{
+    auto it = m_nameIds.find(name);
+    if (it != m_nameIds.end()) return it->second;
+    uint32_t id = static_cast<uint32_t>(m_names.size());
+    uint64_t offset = m_journalSize;
+    m_journalSize += AppendJournalEntry(batch.journal, kJournalName, name);
+    std::string payload(reinterpret_cast<const char*>(&offset), sizeof(offset));
+    AppendJournalEntry(batch.index, kJournalName, payload + name);
+    AddName(name, offset);
+    return id;
+}
+
+static bool ValidJournalHeader(std::string_view bytes, const char (&magic)[8])
+{
+    JournalFileHeader header;
+    if (bytes.size() < sizeof(header)) return false;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    return std::memcmp(header.magic, magic, sizeof(header.magic)) == 0 && header.version == kJournalVersion;
+}
+
+static std::string JournalHeaderBytes(const char (&magic)[8])
+{
+    JournalFileHeader header{};
+    std::memcpy(header.magic, magic, sizeof(header.magic));
+    header.version = kJournalVersion;
+    return std::string(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+static bool TruncateFile(const std::string &filename, uint64_t size)
+{
+#ifdef _WIN32
+    int fd = _open(filename.c_str(), _O_RDWR | _O_BINARY);
+    if (fd < 0) return false;
+    bool ok = _chsize_s(fd, static_cast<__int64>(size)) == 0;
+    _close(fd);
+    return ok;
+#else
+    return truncate(filename.c_str(), static_cast<off_t>(size)) == 0;
+#endif
+}
+
+bool ReportJournal::Open(const std::string &journalFile, const std::string &indexFile)
+{
+    *this = ReportJournal();
+    m_journalFile = journalFile;
+    m_indexFile = indexFile;
+
+    MappedFile journal;
+    if (!journal.Open(journalFile) || journal.View().empty()) {
+        // New journal (an existing empty file is taken over as well)
+        journal.Close();
+        std::ofstream ofs(journalFile, std::ios::binary | std::ios::trunc);
+        ofs << JournalHeaderBytes(kJournalMagic);
+        if (!ofs) return false;
+        ofs.close();
+        m_journalSize = sizeof(JournalFileHeader);
+        m_open = WriteIndex();
+        return m_open;
+    }
+    std::string_view bytes = journal.View();
+    if (!ValidJournalHeader(bytes, kJournalMagic)) {
+        LogWarning(journalFile + " is not a report journal of this version; reports are not journaled");
+        return false;
+    }
+
+    // The index covers a prefix of the journal: take entries as long as they
+    // match the journal entries they describe
+    uint64_t covered = sizeof(JournalFileHeader);
+    bool indexComplete = false;
+    MappedFile index;
+    if (index.Open(indexFile) && ValidJournalHeader(index.View(), kJournalIndexMagic)) {
+        std::string_view indexBytes = index.View();
+        uint64_t offset = sizeof(JournalFileHeader);
+        JournalEntryHeader header;
+        std::string_view payload;
+        while (ReadJournalEntry(indexBytes, offset, header, payload)) {
+            if (header.kind == kJournalName && payload.size() >= sizeof(uint64_t)) {
+                uint64_t nameOffset;
+                std::memcpy(&nameOffset, payload.data(), sizeof(nameOffset));
+                uint64_t end = nameOffset + sizeof(JournalEntryHeader) + (payload.size() - sizeof(nameOffset));
+                if (nameOffset != covered || end > bytes.size()) break;
+                AddName(std::string(payload.substr(sizeof(nameOffset))), nameOffset);
+                covered = end;
+            } else if (header.kind == kJournalReport && payload.size() == sizeof(JournalIndexEntry)) {
+                JournalIndexEntry entry;
+                std::memcpy(&entry, payload.data(), sizeof(entry));
+                if (entry.offset != covered || entry.offset + entry.recordSize > bytes.size() ||
+                    !ValidReport(entry)) {
+                    break;
+                }
+                m_entries.push_back(entry);
+                covered = entry.offset + entry.recordSize;
+            } else {
+                break;
+            }
+            offset += sizeof(header) + header.size;
+        }
+        indexComplete = offset == indexBytes.size();
+    }
+    index.Close();
+
+    // Journal entries the index lacks (e.g. the index is missing or did not
+    // reach the disk before a crash)
+    uint64_t validEnd = covered;
+    bool added = ScanJournal(bytes, covered, validEnd);
+    size_t journalBytes = bytes.size();
+    journal.Close();
+    if (validEnd < journalBytes) {
+        LogWarning("Dropping " + std::to_string(journalBytes - validEnd) + " damaged bytes at the end of " +
+                   journalFile);
+        if (!TruncateFile(journalFile, validEnd)) return false;
+    }
+    m_journalSize = validEnd;
+    if ((added || !indexComplete) && !WriteIndex()) {
+        LogWarning("Could not write " + indexFile);
+        return false;
+    }
+    m_open = true;
+    return true;
+}
+
+// Add the journal entries from 'offset' on; 'validEnd' is left past the
+// last intact entry. Returns true if any entry was added.
+bool ReportJournal::ScanJournal(std::string_view bytes, uint64_t offset, uint64_t &validEnd)
+{
+    bool added = false;
+    JournalEntryHeader header;
+    std::string_view payload;
+    while (ReadJournalEntry(bytes, offset, header, payload)) {
+        uint32_t size = static_cast<uint32_t>(sizeof(header) + header.size);
+        if (header.kind == kJournalName) {
+            AddName(std::string(payload), offset);
+        } else if (header.kind == kJournalReport && payload.size() >= sizeof(JournalReport)) {
+            JournalReport rec;
+            std::memcpy(&rec, payload.data(), sizeof(rec));
+            if (payload.size() != sizeof(rec) + uint64_t(rec.partCount) * sizeof(JournalPart)) break;
+            JournalIndexEntry entry{rec.date, rec.aircraft, rec.system, rec.task, rec.id, size, offset};
+            if (!ValidReport(entry)) break;
+            m_entries.push_back(entry);
+        } else {
+            break;
+        }
+        offset += size;
+        validEnd = offset;
+        added = true;
+    }
+    return added;
+}
+
+// Rewrite the whole index from memory, under a temporary name
+bool ReportJournal::WriteIndex() const
+{
+    std::string out = JournalHeaderBytes(kJournalIndexMagic);
+    size_t name = 0;
+    for (size_t i = 0; i <= m_entries.size(); i++) {
+        uint64_t before = i < m_entries.size() ? m_entries[i].offset : std::numeric_limits<uint64_t>::max();
+        for (; name < m_names.size() && m_nameOffsets[name] < before; name++) {
+            std::string payload(reinterpret_cast<const char*>(&m_nameOffsets[name]), sizeof(uint64_t));
+            AppendJournalEntry(out, kJournalName, payload + m_names[name]);
+        }
+        if (i < m_entries.size()) {
+            AppendJournalEntry(out, kJournalReport,
+                        std::string_view(reinterpret_cast<const char*>(&m_entries[i]), sizeof(m_entries[i])));
+        }
+    }
+
+    std::string tmpFile = m_indexFile + ".tmp";
+    {
+        std::ofstream ofs(tmpFile, std::ios::binary | std::ios::trunc);
+        if (!ofs) return false;
+        ofs.write(out.data(), static_cast<std::streamsize>(out.size()));
+        if (!ofs) {
+            ofs.close();
+            std::remove(tmpFile.c_str());
+            return false;
+        }
+    }
+    return RenameOver(tmpFile, m_indexFile);
+}
+
+// Sort the positions recorded since the last call and merge them into the
+// three orders
+void ReportJournal::UpdateOrders() const
+{
+    size_t sorted = m_byDate.size();
+    if (sorted == m_entries.size()) return;
+    const std::vector<JournalIndexEntry> &e = m_entries;
+    auto byAircraft = [&e](uint32_t a, uint32_t b) {
+        return std::tie(e[a].aircraft, e[a].system, e[a].date, a) < std::tie(e[b].aircraft, e[b].system, e[b].date, b);
+    };
+    auto bySystem = [&e](uint32_t a, uint32_t b) {
+        return std::tie(e[a].system, e[a].date, a) < std::tie(e[b].system, e[b].date, b);
+    };
+    auto byDate = [&e](uint32_t a, uint32_t b) {
+        return std::tie(e[a].date, a) < std::tie(e[b].date, b);
+    };
+    auto extend = [&](std::vector<uint32_t> &order, auto less) {
+        for (size_t i = sorted; i < e.size(); i++) order.push_back(static_cast<uint32_t>(i));
+        std::sort(order.begin() + sorted, order.end(), less);
+        std::inplace_merge(order.begin(), order.begin() + sorted, order.end(), less);
+    };
+    extend(m_byAircraft, byAircraft);
+    extend(m_bySystem, bySystem);
+    extend(m_byDate, byDate);
+}
+
+std::vector<uint32_t> ReportJournal::Query(uint32_t from, uint32_t to, const std::string &aircraft,
+                                           const std::string &system) const
+{
+    std::vector<uint32_t> result;
+    auto nameId = [this](const std::string &name, uint32_t &id) {
+        auto it = m_nameIds.find(name);
+        if (it == m_nameIds.end()) return false;
+        id = it->second;
+        return true;
+    };
+    uint32_t aircraftId = 0, systemId = 0;
+    if ((!aircraft.empty() && !nameId(aircraft, aircraftId)) ||
+        (!system.empty() && !nameId(system, systemId))) {
+        return result;
+    }
+    UpdateOrders();
+
+    // Rows of one order whose key lies in [low, high], within the dates
+    const std::vector<JournalIndexEntry> &e = m_entries;
+    auto range = [&](const std::vector<uint32_t> &order, auto key, auto low, auto high) {
+        auto first = std::partition_point(order.begin(), order.end(),
+                                          [&](uint32_t r) { return key(e[r]) < low; });
+        auto last  = std::partition_point(first, order.end(),
+                                          [&](uint32_t r) { return !(high < key(e[r])); });
+        for (auto it = first; it != last; ++it) {
+            if (e[*it].date >= from && e[*it].date <= to) result.push_back(*it);
+        }
+    };
+    if (!aircraft.empty() && !system.empty()) {
+        range(m_byAircraft, [](const JournalIndexEntry &r) { return std::make_tuple(r.aircraft, r.system, r.date); },
+              std::make_tuple(aircraftId, systemId, from), std::make_tuple(aircraftId, systemId, to));
+    } else if (!aircraft.empty()) {
+        range(m_byAircraft, [](const JournalIndexEntry &r) { return r.aircraft; }, aircraftId, aircraftId);
+    } else if (!system.empty()) {
+        range(m_bySystem, [](const JournalIndexEntry &r) { return std::make_tuple(r.system, r.date); },
+              std::make_tuple(systemId, from), std::make_tuple(systemId, to));
+    } else {
+        range(m_byDate, [](const JournalIndexEntry &r) { return r.date; }, from, to);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::vector<std::string> ReportJournal::Distinct(uint32_t JournalIndexEntry::*field) const
+{
+    std::vector<bool> seen(m_names.size(), false);
+    std::vector<std::string> result;
+    for (auto &entry : m_entries) {
+        uint32_t id = entry.*field;
+        if (seen[id]) continue;
+        seen[id] = true;
+        result.push_back(m_names[id]);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+bool ReportJournal::Read(uint32_t pos, MaintenanceReport &out) const
+{
+    const JournalIndexEntry &entry = m_entries[pos];
+    if (!m_reader.is_open()) m_reader.open(m_journalFile, std::ios::binary);
+    m_reader.clear();
+    m_readBuffer.resize(entry.recordSize);
+    m_reader.seekg(static_cast<std::streamoff>(entry.offset));
+    if (!m_reader.read(&m_readBuffer[0], static_cast<std::streamsize>(m_readBuffer.size()))) return false;
+    return Decode(m_readBuffer, entry, out);
+}
+
+bool ReportJournal::ReadEach(const std::vector<uint32_t> &positions,
+                             const std::function<void(const MaintenanceReport&)> &fn, size_t &unreadable) const
+{
+    unreadable = 0;
+    MappedFile file;
+    if (!file.Open(m_journalFile)) return false;
+    std::string_view bytes = file.View();
+    MaintenanceReport report;
+    for (uint32_t pos : positions) {
+        const JournalIndexEntry &entry = m_entries[pos];
+        // Reports not yet written by the report writer lie past the mapping
+        if (entry.offset > bytes.size() || bytes.size() - entry.offset < entry.recordSize ||
+            !Decode(bytes.substr(static_cast<size_t>(entry.offset), entry.recordSize), entry, report)) {
+            unreadable++;
+            continue;
+        }
+        fn(report);
+    }
+    return true;
+}
+
+bool ReportJournal::Decode(std::string_view bytes, const JournalIndexEntry &entry, MaintenanceReport &out) const
+{
+    JournalEntryHeader header;
+    std::string_view payload;
+    if (!ReadJournalEntry(bytes, 0, header, payload) || header.kind != kJournalReport ||
+        payload.size() < sizeof(JournalReport)) {
+        return false;
+    }
+    JournalReport rec;
+    std::memcpy(&rec, payload.data(), sizeof(rec));
+    if (payload.size() != sizeof(rec) + uint64_t(rec.partCount) * sizeof(JournalPart)) return false;
+
+    out.id = rec.id;
+    out.date = rec.date;
+    out.aircraft = m_names[entry.aircraft];
+    out.system = m_names[entry.system];
+    out.task = m_names[entry.task];
+    out.parts.resize(rec.partCount); // keeps the name buffers of earlier reads
+    for (uint32_t i = 0; i < rec.partCount; i++) {
+        JournalPart part;
+        std::memcpy(&part, payload.data() + sizeof(rec) + i * sizeof(part), sizeof(part));
+        if (part.part >= m_names.size()) return false;
+        out.parts[i].first = m_names[part.part];
+        out.parts[i].second = static_cast<int>(part.quantity);
+    }
+    return true;
+}
+
+ReportJournal g_reportJournal;
+
+static const size_t kExportBufferBytes = 1 << 20; // rendered bytes per write
+
+bool ExportReports(const ReportJournal &journal, const std::vector<uint32_t> &positions,
+                   ReportFormat format, const std::string &filename, size_t &unreadable)
+{
+    FILE *file = fopen(filename.c_str(), "wb");
+    if (!file) return false;
+    std::string buffer;
+    buffer.reserve(kExportBufferBytes + kExportBufferBytes / 4);
+    bool ok = true;
+    auto write = [&]() {
+        ok = ok && fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+        buffer.clear();
+    };
+    RenderReportHeader(format, buffer);
+    bool mapped = journal.ReadEach(positions, [&](const MaintenanceReport &report) {
+        RenderReport(report, format, buffer);
+        if (buffer.size() >= kExportBufferBytes) write();
+    }, unreadable);
+    write();
+    return fclose(file) == 0 && ok && mapped;
+}
+
+// --------------------------- Inventory Service ---------------------------
+
+#ifdef _WIN32
+void CloseSocket(Socket s) { closesocket(s); }
+static bool WouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+static int PollSockets(pollfd *fds, size_t count) { return WSAPoll(fds, static_cast<ULONG>(count), -1); }
+static const int kShutdownBoth = SD_BOTH;
+#else
+void CloseSocket(Socket s) { close(s); }
+static bool WouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+static int PollSockets(pollfd *fds, size_t count) { return poll(fds, static_cast<nfds_t>(count), -1); }
+static const int kShutdownBoth = SHUT_RDWR;
+#endif
+
+bool StartSockets()
+{
+#ifdef _WIN32
+    static const bool started = [] {
+        WSADATA wsa;
+        return WSAStartup(MAKEWORD(2, 2), &wsa) == 0;
+    }();
+#else
+    static const bool started = [] {
+        signal(SIGPIPE, SIG_IGN); // send() to a peer that went away fails instead
+        return true;
+    }();
+#endif
+    return started;
+}
+
+static bool SetNonBlocking(Socket s)
+{
+#ifdef _WIN32
+    u_long on = 1;
+    return ioctlsocket(s, FIONBIO, &on) == 0;
+#else
+    int flags = fcntl(s, F_GETFL, 0);
+    return flags >= 0 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+// Frames are small and answered one by one: send them right away
+static void SetNoDelay(Socket s)
+{
+    int on = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&on), sizeof(on));
+}
+
+// 0 waits forever
+static void SetReceiveTimeout(Socket s, int ms)
+{
+#ifdef _WIN32
+    DWORD timeout = static_cast<DWORD>(ms);
+#else
+    timeval timeout{ms / 1000, (ms % 1000) * 1000};
+#endif
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+}
+
+bool SendAll(Socket s, std::string_view bytes)
+{
+    while (!bytes.empty()) {
+        int sent = send(s, bytes.data(), static_cast<int>(std::min<size_t>(bytes.size(), 1 << 30)), 0);
+        if (sent <= 0) return false;
+        bytes.remove_prefix(static_cast<size_t>(sent));
+    }
+    return true;
+}
+
+Socket ListenTcp(uint16_t port, int backlog)
+{
+    Socket s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET) {
+        LogError("Could not create a socket");
+        return INVALID_SOCKET;
+    }
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(s, backlog) != 0) {
+        LogError("Could not listen on port " + std::to_string(port));
+        CloseSocket(s);
+        return INVALID_SOCKET;
+    }
+    return s;
+}
+
+static const uint32_t kMaxStockFrameBytes = 16 << 20;
+static const PartId   kNoPart = std::numeric_limits<PartId>::max();
+
+static void PutU32(std::string &out, uint32_t v)
+{
+    char bytes[4] = {static_cast<char>(v), static_cast<char>(v >> 8),
+                     static_cast<char>(v >> 16), static_cast<char>(v >> 24)};
+    out.append(bytes, 4);
+}
+
+static void PutU64(std::string &out, uint64_t v)
+{
+    PutU32(out, static_cast<uint32_t>(v));
+    PutU32(out, static_cast<uint32_t>(v >> 32));
+}
+
+static uint32_t GetU32(const char *p)
+{
+    const unsigned char *u = reinterpret_cast<const unsigned char*>(p);
+    return u[0] | (u[1] << 8) | (u[2] << 16) | (static_cast<uint32_t>(u[3]) << 24);
+}
+
+// Start a frame in 'out'; EndFrame() fills in its size
+static size_t BeginFrame(std::string &out, StockFrame type)
+{
+    size_t start = out.size();
+    PutU32(out, 0);
+    out.push_back(static_cast<char>(type));
+    return start;
+}
+
+static void EndFrame(std::string &out, size_t start)
+{
+    uint32_t size = static_cast<uint32_t>(out.size() - start - 4);
+    for (int i = 0; i < 4; i++) out[start + i] = static_cast<char>(size >> (8 * i));
+}
+
+// Length of the complete frame at buffer[pos], 0 if it is not complete yet
+// or -1 if its size is invalid
+static long FrameLength(const std::string &buffer, size_t pos)
+{
+    if (buffer.size() - pos < 4) return 0;
+    uint32_t size = GetU32(buffer.data() + pos);
+    if (size == 0 || size > kMaxStockFrameBytes) return -1;
+    return buffer.size() - pos - 4 >= size ? static_cast<long>(size) + 4 : 0;
+}
+
+// Fields of one frame body; 'ok' turns false when the body is too short
+struct FrameReader {
+    const char *p;
+    const char *end;
+    bool        ok = true;
+
+    bool Has(size_t count, size_t size)
+    {
+        if (static_cast<size_t>(end - p) / size < count) ok = false;
+        return ok;
+    }
+    uint32_t U32()
+    {
+        if (!Has(1, 4)) return 0;
+        uint32_t v = GetU32(p);
+        p += 4;
+        return v;
+    }
+    int32_t I32() { return static_cast<int32_t>(U32()); }
+    uint64_t U64()
+    {
+        uint64_t low = U32();
+        return low | static_cast<uint64_t>(U32()) << 32;
+    }
+    uint8_t U8()
+    {
+        if (!Has(1, 1)) return 0;
+        return static_cast<uint8_t>(*p++);
+    }
+    uint16_t U16()
+    {
+        if (!Has(1, 2)) return 0;
+        uint16_t v = static_cast<uint16_t>(static_cast<unsigned char>(p[0]) | (static_cast<unsigned char>(p[1]) << 8));
+        p += 2;
+        return v;
+    }
+    std::string_view Bytes(size_t count)
+    {
+        if (!Has(count, 1)) return {};
+        std::string_view v(p, count);
+        p += count;
+        return v;
+    }
+};
+
+// The server: one thread polls every terminal, so requests are applied
+// strictly one after another and a Result always reflects the stock its
+// request saw. Sockets are non-blocking; a terminal too slow to take its
+// pushed updates is dropped rather than holding the others up.
+class InventoryServer
+{
+public:
+    ~InventoryServer()
+    {
+        for (auto &c : m_clients) CloseSocket(c->socket);
+        if (m_listener != INVALID_SOCKET) CloseSocket(m_listener);
+    }
+
+    bool Listen(uint16_t port)
+    {
+        m_listener = ListenTcp(port, 64);
+        if (m_listener == INVALID_SOCKET) return false;
+        if (!SetNonBlocking(m_listener)) {
+            LogError("Could not listen on port " + std::to_string(port));
+            return false;
+        }
+        return true;
+    }
+
+    void Run()
+    {
+        std::vector<pollfd> fds;
+        for (;;) {
+            fds.clear();
+            fds.push_back({m_listener, POLLIN, 0});
+            for (auto &c : m_clients) {
+                short events = POLLIN;
+                if (c->sent < c->out.size()) events |= POLLOUT;
+                fds.push_back({c->socket, events, 0});
+            }
+            if (PollSockets(fds.data(), fds.size()) < 0) continue;
+
+            // A connection replaced by its terminal's new one is not read again
+            for (size_t i = 1; i < fds.size(); i++) {
+                Client &c = *m_clients[i - 1];
+                if (fds[i].revents && !c.closing && !Read(c)) c.closing = true;
+            }
+            if (fds[0].revents & POLLIN) Accept();
+
+            // Results and this pass's updates go out together; dropping a
+            // terminal rolls its reservations back, which is another change
+            for (;;) {
+                DropClosing();
+                Broadcast();
+                bool dropped = false;
+                for (auto &c : m_clients) {
+                    if (!Send(*c)) c->closing = dropped = true;
+                }
+                if (!dropped) break;
+            }
+        }
+    }
+
+private:
+    struct Client {
+        Socket      socket = INVALID_SOCKET;
+        uint64_t    terminal = 0;
+        std::string in;
+        std::string out;
+        size_t      sent = 0;
+        bool        welcomed = false;
+        bool        closing = false;
+        std::unordered_map<uint32_t, StockInventory::Reservation> reservations; // by request
+    };
+
+    // Committed requests of a terminal, for Settle. Terminals number their
+    // requests upwards, so once the oldest are dropped every request up to
+    // 'forgotten' may have been committed.
+    struct History {
+        std::deque<uint32_t>         order; // oldest first
+        std::unordered_set<uint32_t> committed;
+        uint32_t                     forgotten = 0;
+        uint64_t                     lastSeen = 0;
+    };
+
+    static const size_t kMaxPendingOutput = 64 << 20;
+    static const size_t kSettleHistory = 4096; // requests per terminal
+    static const size_t kMaxTerminals = 256;
+
+    Socket                               m_listener = INVALID_SOCKET;
+    std::unordered_map<uint64_t, History> m_history; // by terminal
+    uint64_t                             m_seen = 0;
+    std::vector<std::unique_ptr<Client>> m_clients;
+    std::vector<PartId>                  m_changed;   // parts changed in this pass
+    std::vector<char>                    m_isChanged; // by PartId
+    std::vector<PartDemand>              m_demands;
+    std::vector<PartId>                  m_parts;
+
+    void Accept()
+    {
+        for (;;) {
+            Socket s = accept(m_listener, nullptr, nullptr);
+            if (s == INVALID_SOCKET) return;
+            if (!SetNonBlocking(s)) {
+                CloseSocket(s);
+                continue;
+            }
+            SetNoDelay(s);
+            m_clients.emplace_back(new Client);
+            m_clients.back()->socket = s;
+        }
+    }
+
+    // Take what the terminal sent and answer every complete frame.
+    // False if it went away or broke the protocol.
+    bool Read(Client &c)
+    {
+        char buffer[64 << 10];
+        for (;;) {
+            int n = recv(c.socket, buffer, static_cast<int>(sizeof(buffer)), 0);
+            if (n == 0) return false;
+            if (n < 0) {
+                if (WouldBlock()) break;
+                return false;
+            }
+            c.in.append(buffer, static_cast<size_t>(n));
+        }
+        size_t pos = 0;
+        long length;
+        while ((length = FrameLength(c.in, pos)) > 0) {
+            uint8_t type = static_cast<uint8_t>(c.in[pos + 4]);
+            FrameReader body{c.in.data() + pos + 5, c.in.data() + pos + length};
+            if (!c.welcomed && type != static_cast<uint8_t>(StockFrame::Hello)) return false;
+            if (!Handle(c, static_cast<StockFrame>(type), body) || !body.ok) return false;
+            pos += static_cast<size_t>(length);
+        }
+        c.in.erase(0, pos);
+        return length == 0;
+    }
+
+    bool Handle(Client &c, StockFrame type, FrameReader &body)
+    {
+        switch (type) {
+        case StockFrame::Hello: {
+            body.U32(); // the terminal refuses a version it does not speak
+            c.terminal = body.U64();
+            if (!body.ok) return false;
+            for (auto &other : m_clients) {
+                if (other.get() != &c && other->terminal == c.terminal) other->closing = true;
+            }
+            Seen(c.terminal);
+            size_t start = BeginFrame(c.out, StockFrame::Welcome);
+            PutU32(c.out, kStockProtocolVersion);
+            PutU32(c.out, static_cast<uint32_t>(stockParts.size()));
+            for (PartId p : stockParts) {
+                const std::string &name = g_partRegistry.Name(p);
+                size_t length = std::min<size_t>(name.size(), std::numeric_limits<uint16_t>::max());
+                PutU32(c.out, p);
+                PutU32(c.out, static_cast<uint32_t>(stockInventory.Quantity(p)));
+                c.out.push_back(static_cast<char>(length));
+                c.out.push_back(static_cast<char>(length >> 8));
+                c.out.append(name, 0, length);
+            }
+            EndFrame(c.out, start);
+            c.welcomed = true;
+            return true;
+        }
+        case StockFrame::Reserve:
+        case StockFrame::Deduct: {
+            uint32_t request = body.U32();
+            uint32_t count = body.U32();
+            if (!body.Has(count, 8)) return false;
+            m_demands.clear();
+            bool valid = type == StockFrame::Deduct || c.reservations.count(request) == 0;
+            for (uint32_t i = 0; i < count; i++) {
+                PartDemand d;
+                d.part = body.U32();
+                d.quantity = body.I32();
+                if (d.quantity <= 0) valid = false;
+                m_demands.push_back(d);
+            }
+            m_parts.clear();
+            if (!valid) {
+                PutResult(c, request, StockStatus::Invalid);
+                return true;
+            }
+            StockInventory::Reservation reservation;
+            if (!stockInventory.Reserve(m_demands, reservation, &m_parts)) {
+                PutResult(c, request, StockStatus::Short);
+                return true;
+            }
+            if (type == StockFrame::Deduct) {
+                stockInventory.Commit(reservation);
+                g_stockLedger.RecordDeduction(m_demands, 0);
+                Remember(c.terminal, request);
+            } else {
+                c.reservations.emplace(request, std::move(reservation));
+            }
+            for (const PartDemand &d : m_demands) {
+                m_parts.push_back(d.part);
+                Changed(d.part);
+            }
+            PutResult(c, request, StockStatus::Ok);
+            return true;
+        }
+        case StockFrame::Commit:
+        case StockFrame::Rollback: {
+            uint32_t request = body.U32();
+            m_parts.clear();
+            auto it = c.reservations.find(request);
+            if (it == c.reservations.end()) {
+                PutResult(c, request, StockStatus::Invalid);
+                return true;
+            }
+            if (type == StockFrame::Commit) {
+                g_stockLedger.RecordDeduction(it->second.Parts(), 0);
+                stockInventory.Commit(it->second);
+                Remember(c.terminal, request);
+            } else {
+                for (const PartDemand &d : it->second.Parts()) {
+                    m_parts.push_back(d.part);
+                    Changed(d.part);
+                }
+                stockInventory.Rollback(it->second);
+            }
+            c.reservations.erase(it);
+            PutResult(c, request, StockStatus::Ok);
+            return true;
+        }
+        case StockFrame::Settle: {
+            uint32_t request = body.U32();
+            m_parts.clear();
+            StockStatus status = StockStatus::Unknown;
+            auto h = m_history.find(c.terminal);
+            if (h != m_history.end()) {
+                if (h->second.committed.count(request)) status = StockStatus::Ok;
+                else if (request > h->second.forgotten) status = StockStatus::Invalid;
+            }
+            PutResult(c, request, status);
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    // The history of 'terminal', made room for among the others if new
+    History &Seen(uint64_t terminal)
+    {
+        auto it = m_history.find(terminal);
+        if (it == m_history.end()) {
+            if (m_history.size() >= kMaxTerminals) {
+                auto oldest = m_history.begin();
+                for (auto h = m_history.begin(); h != m_history.end(); ++h) {
+                    if (h->second.lastSeen < oldest->second.lastSeen) oldest = h;
+                }
+                m_history.erase(oldest);
+            }
+            it = m_history.emplace(terminal, History()).first;
+        }
+        it->second.lastSeen = ++m_seen;
+        return it->second;
+    }
+
+    void Remember(uint64_t terminal, uint32_t request)
+    {
+        History &h = Seen(terminal);
+        if (h.order.size() >= kSettleHistory) {
+            h.forgotten = std::max(h.forgotten, h.order.front());
+            h.committed.erase(h.order.front());
+            h.order.pop_front();
+        }
+        h.order.push_back(request);
+        h.committed.insert(request);
+    }
+
+    // Result of 'request' naming the parts in m_parts
+    void PutResult(Client &c, uint32_t request, StockStatus status)
+    {
+        size_t start = BeginFrame(c.out, StockFrame::Result);
+        PutU32(c.out, request);
+        c.out.push_back(static_cast<char>(status));
+        PutQuantities(c.out, m_parts);
+        EndFrame(c.out, start);
+    }
+
+    static void PutQuantities(std::string &out, const std::vector<PartId> &parts)
+    {
+        PutU32(out, static_cast<uint32_t>(parts.size()));
+        for (PartId p : parts) {
+            PutU32(out, p);
+            PutU32(out, static_cast<uint32_t>(stockInventory.Quantity(p)));
+        }
+    }
+
+    void Changed(PartId p)
+    {
+        if (p >= m_isChanged.size()) m_isChanged.resize(p + 1, 0);
+        if (m_isChanged[p]) return;
+        m_isChanged[p] = 1;
+        m_changed.push_back(p);
+    }
+
+    // One Update with this pass's changes for every terminal
+    void Broadcast()
+    {
+        if (m_changed.empty()) return;
+        std::string update;
+        size_t start = BeginFrame(update, StockFrame::Update);
+        PutQuantities(update, m_changed);
+        EndFrame(update, start);
+        for (auto &c : m_clients) {
+            if (c->welcomed) c->out += update;
+        }
+        for (PartId p : m_changed) m_isChanged[p] = 0;
+        m_changed.clear();
+    }
+
+    // Send what the socket takes now; false if the terminal is gone or too far behind
+    bool Send(Client &c)
+    {
+        while (c.sent < c.out.size()) {
+            int n = send(c.socket, c.out.data() + c.sent,
+                         static_cast<int>(std::min<size_t>(c.out.size() - c.sent, 1 << 30)), 0);
+            if (n < 0 && WouldBlock()) break;
+            if (n <= 0) return false;
+            c.sent += static_cast<size_t>(n);
+        }
+        if (c.sent == c.out.size()) {
+            c.out.clear();
+            c.sent = 0;
+        }
+        return c.out.size() - c.sent <= kMaxPendingOutput;
+    }
+
+    void DropClosing()
+    {
+        for (size_t i = 0; i < m_clients.size();) {
+            Client &c = *m_clients[i];
+            if (!c.closing) {
+                i++;
+                continue;
+            }
+            for (auto &r : c.reservations) {
+                for (const PartDemand &d : r.second.Parts()) Changed(d.part);
+                stockInventory.Rollback(r.second);
+            }
+            CloseSocket(c.socket);
+            m_clients.erase(m_clients.begin() + static_cast<long>(i));
+        }
+    }
+};
+
+bool ServeInventory(uint16_t port)
+{
+    if (!StartSockets()) {
+        LogError("Could not start networking");
+        return false;
+    }
+    InventoryServer server;
+    if (!server.Listen(port)) return false;
+    server.Run();
+    return true;
+}
+
+InventoryClient g_inventoryClient;
+
+// Mirror the {part, available} records of a Result or Update; returns the
+// local ids of the parts
+static std::vector<PartId> ApplyQuantities(FrameReader &body, uint32_t count,
+                                           const std::vector<PartId> &localPart)
+{
+    std::vector<PartId> parts;
+    parts.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t part = body.U32();
+        int quantity = body.I32();
+        PartId local = part < localPart.size() ? localPart[part] : kNoPart;
+        if (local == kNoPart) continue;
+        stockInventory.SetQuantity(local, quantity);
+        parts.push_back(local);
+    }
+    return parts;
+}
+
+bool InventoryClient::Connect(const std::string &address, std::vector<std::pair<PartId, int>> &quantities)
+{
+    Shutdown();
+    std::lock_guard<std::mutex> connection(m_connectMutex);
+    m_address = address;
+    if (m_terminal == 0) {
+        std::random_device random;
+        m_terminal = (static_cast<uint64_t>(random()) << 32 | random()) ^
+                     static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    }
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == address.size()) {
+        LogError("Invalid stock server address (host:port expected): " + address);
+        return false;
+    }
+    if (!StartSockets()) {
+        LogError("Could not start networking");
+        return false;
+    }
+    std::string host = address.substr(0, colon);
+    std::string port = address.substr(colon + 1);
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *list = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &list) != 0) {
+        LogError("Unknown stock server: " + address);
+        return false;
+    }
+    Socket s = INVALID_SOCKET;
+    for (addrinfo *a = list; a; a = a->ai_next) {
+        s = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (s == INVALID_SOCKET) continue;
+        if (connect(s, a->ai_addr, static_cast<int>(a->ai_addrlen)) == 0) break;
+        CloseSocket(s);
+        s = INVALID_SOCKET;
+    }
+    freeaddrinfo(list);
+    if (s == INVALID_SOCKET) {
+        LogError("Could not connect to the stock server " + address);
+        return false;
+    }
+    SetNoDelay(s);
+    SetReceiveTimeout(s, kStockRequestTimeoutMs);
+    m_socket = static_cast<intptr_t>(s);
+    m_received.clear();
+
+    std::string hello;
+    size_t start = BeginFrame(hello, StockFrame::Hello);
+    PutU32(hello, kStockProtocolVersion);
+    PutU64(hello, m_terminal);
+    EndFrame(hello, start);
+    uint8_t type = 0;
+    std::string welcome;
+    if (!SendAll(s, hello) || !ReadFrame(type, welcome) || type != static_cast<uint8_t>(StockFrame::Welcome)) {
+        LogError("The stock server " + address + " did not answer");
+        Close();
+        return false;
+    }
+    FrameReader body{welcome.data(), welcome.data() + welcome.size()};
+    uint32_t version = body.U32();
+    if (version != kStockProtocolVersion) {
+        LogError("The stock server " + address + " uses protocol version " + std::to_string(version));
+        Close();
+        return false;
+    }
+
+    // Map the server's part ids onto ours by name
+    uint32_t count = body.U32();
+    m_localPart.clear();
+    m_serverPart.clear();
+    quantities.clear();
+    for (uint32_t i = 0; i < count && body.ok; i++) {
+        uint32_t part = body.U32();
+        int quantity = body.I32();
+        std::string_view name = body.Bytes(body.U16());
+        if (!body.ok || part >= kMaxStockFrameBytes) break;
+        PartId local = g_partRegistry.Intern(name);
+        if (part >= m_localPart.size()) m_localPart.resize(part + 1, kNoPart);
+        m_localPart[part] = local;
+        if (local >= m_serverPart.size()) m_serverPart.resize(local + 1, kNoPart);
+        m_serverPart[local] = part;
+        quantities.push_back({local, quantity});
+    }
+    if (!body.ok || quantities.size() != count) {
+        LogError("Invalid stock list from the stock server " + address);
+        Close();
+        return false;
+    }
+    std::sort(quantities.begin(), quantities.end()); // by PartId, as ReadStockFile leaves them
+    if (!Settle(quantities)) {
+        LogError("The stock server " + address + " did not answer");
+        Close();
+        return false;
+    }
+
+    SetReceiveTimeout(s, 0);
+    m_connected = true;
+    m_active = true;
+    return true;
+}
+
+bool InventoryClient::Reconnect(std::vector<std::pair<PartId, int>> &quantities)
+{
+    std::string address = m_address;
+    return Connect(address, quantities);
+}
+
+// Ask about every commit left unanswered on an earlier connection (the
+// receiver is not running yet). Updates read meanwhile are folded into
+// 'quantities'. False if the server did not answer.
+bool InventoryClient::Settle(std::vector<std::pair<PartId, int>> &quantities)
+{
+    std::vector<uint32_t> requests;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        requests = m_unsettled;
+    }
+    if (requests.empty()) return true;
+    std::string frames;
+    for (uint32_t request : requests) {
+        size_t start = BeginFrame(frames, StockFrame::Settle);
+        PutU32(frames, request);
+        EndFrame(frames, start);
+    }
+    if (!SendAll(static_cast<Socket>(m_socket), frames)) return false;
+
+    uint8_t type = 0;
+    std::string frame;
+    for (size_t answered = 0; answered < requests.size();) {
+        if (!ReadFrame(type, frame)) return false;
+        FrameReader body{frame.data(), frame.data() + frame.size()};
+        if (type == static_cast<uint8_t>(StockFrame::Update)) {
+            uint32_t count = body.U32();
+            for (uint32_t i = 0; i < count && body.ok; i++) {
+                uint32_t part = body.U32();
+                int quantity = body.I32();
+                PartId local = part < m_localPart.size() ? m_localPart[part] : kNoPart;
+                auto q = std::lower_bound(quantities.begin(), quantities.end(),
+                                          std::make_pair(local, std::numeric_limits<int>::min()));
+                if (q != quantities.end() && q->first == local) q->second = quantity;
+            }
+            continue;
+        }
+        if (type != static_cast<uint8_t>(StockFrame::Result)) return false;
+        uint32_t request = body.U32();
+        StockStatus status = static_cast<StockStatus>(body.U8());
+        if (!body.ok) return false;
+        DeductResult outcome = status == StockStatus::Ok      ? DeductResult::Done
+                             : status == StockStatus::Invalid ? DeductResult::Offline
+                                                              : DeductResult::Unknown;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_unsettled.erase(std::remove(m_unsettled.begin(), m_unsettled.end(), request), m_unsettled.end());
+        m_settled.push_back({request, outcome});
+        answered++;
+    }
+    return true;
+}
+
+void InventoryClient::Start(std::function<void(std::vector<PartId>)> onChange, std::function<void()> onLost,
+                            std::function<void(StockSettlement)> onSettled)
+{
+    if (!m_connected || m_receiver.joinable()) return;
+    m_onChange = std::move(onChange);
+    m_onLost = std::move(onLost);
+    m_onSettled = std::move(onSettled);
+    m_receiver = std::thread(&InventoryClient::Receive, this);
+}
+
+void InventoryClient::Disconnect()
+{
+    m_active = false;
+    Shutdown();
+}
+
+// Stop the receiver and close the socket; the client stays Active
+void InventoryClient::Shutdown()
+{
+    if (m_socket == -1) return;
+    m_stopping = true;
+    shutdown(static_cast<Socket>(m_socket), kShutdownBoth); // wakes the receiver and a waiting Deduct
+    if (m_receiver.joinable()) m_receiver.join();
+    std::lock_guard<std::mutex> connection(m_connectMutex);
+    Close();
+    m_stopping = false;
+}
+
+void InventoryClient::Close()
+{
+    CloseSocket(static_cast<Socket>(m_socket));
+    m_socket = -1;
+    m_connected = false;
+}
+
+// Blocking read of the next frame
+bool InventoryClient::ReadFrame(uint8_t &type, std::string &body)
+{
+    char buffer[16 << 10];
+    for (;;) {
+        long length = FrameLength(m_received, 0);
+        if (length < 0) return false;
+        if (length > 0) {
+            type = static_cast<uint8_t>(m_received[4]);
+            body.assign(m_received, 5, static_cast<size_t>(length) - 5);
+            m_received.erase(0, static_cast<size_t>(length));
+            return true;
+        }
+        int n = recv(static_cast<Socket>(m_socket), buffer, static_cast<int>(sizeof(buffer)), 0);
+        if (n <= 0) return false;
+        m_received.append(buffer, static_cast<size_t>(n));
+    }
+}
+
+// Receiving thread: mirrors every quantity the server sends
+void InventoryClient::Receive()
+{
+    std::vector<StockSettlement> settled;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        settled.swap(m_settled);
+    }
+    if (m_onSettled) {
+        for (const StockSettlement &s : settled) m_onSettled(s);
+    }
+
+    uint8_t type = 0;
+    std::string frame;
+    while (ReadFrame(type, frame)) {
+        FrameReader body{frame.data(), frame.data() + frame.size()};
+        if (type == static_cast<uint8_t>(StockFrame::Result)) {
+            uint32_t request = body.U32();
+            StockStatus status = static_cast<StockStatus>(body.U8());
+            uint32_t count = body.U32();
+            if (!body.Has(count, 8)) break;
+            std::vector<PartId> parts = ApplyQuantities(body, count, m_localPart);
+            bool late = false;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto it = m_pending.find(request);
+                if (it != m_pending.end()) {
+                    it->second->done = true;
+                    it->second->status = status;
+                    it->second->parts = std::move(parts);
+                    m_pending.erase(it);
+                    m_resultReady.notify_all();
+                } else {
+                    // Its caller gave up waiting; a Commit's answer settles it
+                    auto u = std::find(m_unsettled.begin(), m_unsettled.end(), request);
+                    if (u != m_unsettled.end()) {
+                        m_unsettled.erase(u);
+                        late = true;
+                    }
+                }
+            }
+            if (late && m_onSettled) {
+                m_onSettled({request, status == StockStatus::Ok ? DeductResult::Done : DeductResult::Offline});
+            }
+        } else if (type == static_cast<uint8_t>(StockFrame::Update)) {
+            uint32_t count = body.U32();
+            if (!body.Has(count, 8)) break;
+            std::vector<PartId> parts = ApplyQuantities(body, count, m_localPart);
+            if (m_onChange && !parts.empty()) m_onChange(std::move(parts));
+        } else {
+            break;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_connected = false;
+        m_resultReady.notify_all();
+    }
+    if (m_active && !m_stopping) {
+        LogError("Lost the connection to the stock server");
+        if (m_onLost) m_onLost();
+    }
+}
+
+DeductResult InventoryClient::Deduct(Span<PartDemand> demands, std::vector<PartId> *shortParts,
+                                     uint32_t *unsettled)
+{
+    if (demands.empty()) return DeductResult::Done;
+    std::lock_guard<std::mutex> connection(m_connectMutex);
+    if (!m_connected) return DeductResult::Offline;
+
+    // Parts the server does not stock are short without asking
+    bool stocked = true;
+    for (const PartDemand &d : demands) {
+        if (d.part >= m_serverPart.size() || m_serverPart[d.part] == kNoPart) {
+            stocked = false;
+            if (shortParts) shortParts->push_back(d.part);
+        }
+    }
+    if (!stocked) return DeductResult::Short;
+
+    uint32_t request;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        request = ++m_nextRequest;
+    }
+    Pending reserved;
+    if (!Request(StockFrame::Reserve, request, demands, &reserved)) {
+        // A Rollback behind the Reserve undoes it should the server make it,
+        // as the server does for a connection that drops: nothing is deducted
+        Request(StockFrame::Rollback, request, {}, nullptr);
+        return DeductResult::Offline;
+    }
+    switch (reserved.status) {
+    case StockStatus::Ok:
+        break;
+    case StockStatus::Short:
+        if (shortParts) shortParts->insert(shortParts->end(), reserved.parts.begin(), reserved.parts.end());
+        return DeductResult::Short;
+    default:
+        LogWarning("The stock server refused a deduction");
+        return DeductResult::Offline;
+    }
+
+    Pending committed;
+    if (!Request(StockFrame::Commit, request, {}, &committed)) {
+        LogWarning("The stock server did not confirm deduction request " + std::to_string(request) +
+                   "; it is settled once the server answers");
+        if (unsettled) *unsettled = request;
+        return DeductResult::Unknown;
+    }
+    if (committed.status != StockStatus::Ok) {
+        LogWarning("The stock server refused a deduction");
+        return DeductResult::Offline;
+    }
+    return DeductResult::Done;
+}
+
+bool InventoryClient::Send(const std::string &frame)
+{
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    return SendAll(static_cast<Socket>(m_socket), frame);
+}
+
+// Send one request and, given 'pending', wait for its Result. False if it
+// went unanswered; an unanswered Commit is left to settle.
+bool InventoryClient::Request(StockFrame type, uint32_t request, Span<PartDemand> demands, Pending *pending)
+{
+    std::string frame;
+    size_t start = BeginFrame(frame, type);
+    PutU32(frame, request);
+    if (type == StockFrame::Reserve) {
+        PutU32(frame, static_cast<uint32_t>(demands.size()));
+        for (const PartDemand &d : demands) {
+            PutU32(frame, m_serverPart[d.part]);
+            PutU32(frame, static_cast<uint32_t>(d.quantity));
+        }
+    }
+    EndFrame(frame, start);
+    if (!pending) return Send(frame);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending[request] = pending;
+    }
+    bool sent = Send(frame);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (sent) {
+        m_resultReady.wait_for(lock, std::chrono::milliseconds(kStockRequestTimeoutMs),
+                               [&] { return pending->done || !m_connected; });
+    }
+    if (pending->done) return true;
+    m_pending.erase(request);
+    // Sent or not, a Commit the server may have read is settled later,
+    // from its late Result or after reconnecting
+    if (type == StockFrame::Commit) m_unsettled.push_back(request);
+    return false;
+}
+
+// --------------------------- Stock Ledger ---------------------------
+// Both files start with a JournalFileHeader and hold journal-style entries:
+//   log       generation entry: uint64, the snapshot generation it follows
+//             name entry:       part name chars (name ids count them in order)
+//             deduction entry:  uint32 report id, uint32 n, n x {uint32 name, int32 delta}
+//   snapshot  one snapshot entry: uint64 generation, uint32 n,
+//             n x {int32 quantity, int32 stock.txt quantity or kNotInStockFile,
+//                  uint16 length, name chars}
+// A new snapshot replaces the old one before the log restarts, so after a
+// crash in between the log belongs to an older generation and is ignored.
+
+static const char     kLedgerMagic[8]         = {'M', 'R', 'O', 'S', 'W', 'A', 'L', '\0'};
+static const char     kLedgerSnapshotMagic[8] = {'M', 'R', 'O', 'S', 'S', 'N', 'P', '\0'};
+static const int32_t  kNotInStockFile         = std::numeric_limits<int32_t>::min();
+static const size_t   kLedgerCompactRecords   = 100000; // deductions between snapshots
+static const auto     kLedgerGroupWindow      = std::chrono::milliseconds(2);
+
+enum LedgerEntryKind : uint32_t {
+    kLedgerName = 1, kLedgerDeduction = 2, kLedgerGeneration = 3, kLedgerSnapshot = 4
+};
+
+StockLedger g_stockLedger;
+
+static bool ReadLedgerSnapshot(const std::string &filename, uint64_t &generation,
+                               std::vector<int> &live, std::vector<std::pair<PartId, int>> &baseline)
+{
+    MappedFile file;
+    if (!file.Open(filename)) return false;
+    std::string_view bytes = file.View();
+    JournalEntryHeader header;
+    std::string_view payload;
+    if (!ValidJournalHeader(bytes, kLedgerSnapshotMagic) ||
+        !ReadJournalEntry(bytes, sizeof(JournalFileHeader), header, payload) ||
+        header.kind != kLedgerSnapshot || payload.size() < 12) {
+        return false;
+    }
+    uint32_t count;
+    std::memcpy(&generation, payload.data(), sizeof(generation));
+    std::memcpy(&count, payload.data() + 8, sizeof(count));
+    live.clear();
+    baseline.clear();
+    size_t pos = 12;
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t quantity, fileQuantity;
+        uint16_t length;
+        if (payload.size() - pos < 10) return false;
+        std::memcpy(&quantity, payload.data() + pos, 4);
+        std::memcpy(&fileQuantity, payload.data() + pos + 4, 4);
+        std::memcpy(&length, payload.data() + pos + 8, 2);
+        pos += 10;
+        if (payload.size() - pos < length) return false;
+        PartId part = g_partRegistry.Intern(payload.substr(pos, length));
+        pos += length;
+        if (part >= live.size()) live.resize(part + 1, 0);
+        live[part] = quantity;
+        if (fileQuantity != kNotInStockFile) baseline.push_back({part, fileQuantity});
+    }
+    std::sort(baseline.begin(), baseline.end());
+    return pos == payload.size();
+}
+
+bool StockLedger::Open(const std::string &logFile, const std::string &snapshotFile, LoadedStock &stock)
+{
+    Stop();
+    m_logFile = logFile;
+    m_snapshotFile = snapshotFile;
+    m_generation = 0;
+    m_logRecords = 0;
+    m_logNames.clear();
+    m_logNameCount = 0;
+    m_live.clear();
+    m_file.clear();
+    m_pending.clear();
+
+    // A crash while a snapshot replaced the old one can leave only the .tmp
+    bool restored = ReadLedgerSnapshot(snapshotFile, m_generation, m_live, m_file);
+    if (!restored && ReadLedgerSnapshot(snapshotFile + ".tmp", m_generation, m_live, m_file)) {
+        restored = RenameOver(snapshotFile + ".tmp", snapshotFile);
+    }
+    if (!restored) {
+        m_generation = 0;
+        m_live.clear();
+        m_file.clear();
+    }
+
+    // Replay the log written after the snapshot, up to a torn last entry
+    bool replayed = false;
+    uint64_t validEnd = 0;
+    size_t logBytes = 0;
+    {
+        MappedFile log;
+        if (restored && log.Open(logFile)) {
+            std::string_view bytes = log.View();
+            logBytes = bytes.size();
+            uint64_t offset = sizeof(JournalFileHeader);
+            JournalEntryHeader header;
+            std::string_view payload;
+            uint64_t generation = 0;
+            if (ValidJournalHeader(bytes, kLedgerMagic) && ReadJournalEntry(bytes, offset, header, payload) &&
+                header.kind == kLedgerGeneration && payload.size() == sizeof(generation)) {
+                std::memcpy(&generation, payload.data(), sizeof(generation));
+                replayed = generation == m_generation;
+                offset += sizeof(header) + header.size;
+            }
+            std::vector<PartId> names;
+            auto replay = [&](std::string_view entry) {
+                uint32_t head[2]; // report id, count
+                if (entry.size() < sizeof(head)) return false;
+                std::memcpy(head, entry.data(), sizeof(head));
+                if ((entry.size() - sizeof(head)) / 8 != head[1] || (entry.size() - sizeof(head)) % 8) return false;
+                for (uint32_t i = 0; i < head[1]; i++) {
+                    uint32_t name;
+                    std::memcpy(&name, entry.data() + sizeof(head) + 8 * i, 4);
+                    if (name >= names.size()) return false;
+                }
+                for (uint32_t i = 0; i < head[1]; i++) {
+                    uint32_t name;
+                    int32_t delta;
+                    std::memcpy(&name, entry.data() + sizeof(head) + 8 * i, 4);
+                    std::memcpy(&delta, entry.data() + sizeof(head) + 8 * i + 4, 4);
+                    AddLive(names[name], delta);
+                }
+                return true;
+            };
+            while (replayed && ReadJournalEntry(bytes, offset, header, payload)) {
+                if (header.kind == kLedgerName) {
+                    PartId part = g_partRegistry.Intern(payload);
+                    if (part >= m_logNames.size()) m_logNames.resize(part + 1, kNoPart);
+                    m_logNames[part] = m_logNameCount++;
+                    names.push_back(part);
+                } else if (header.kind != kLedgerDeduction || !replay(payload)) {
+                    break;
+                } else {
+                    m_logRecords++;
+                }
+                offset += sizeof(header) + header.size;
+            }
+            validEnd = offset;
+        }
+    }
+    if (replayed) {
+        if (validEnd < logBytes) {
+            LogWarning("Dropping " + std::to_string(logBytes - validEnd) + " damaged bytes at the end of " + logFile);
+            replayed = TruncateFile(logFile, validEnd);
+        }
+        if (replayed) m_log = fopen(logFile.c_str(), "ab");
+    }
+    if (!m_log && !StartLog()) return false;
+    m_open = true;
+
+    stock.restored = restored;
+    if (restored) {
+        for (PartId p = 0; p < m_live.size(); p++) {
+            if (m_live[p] != 0) stock.live.push_back({p, m_live[p]});
+        }
+        stock.baseline = m_file;
+    }
+    return true;
+}
+
+void StockLedger::Start(int syncIntervalMs)
+{
+    if (!m_open || m_running) return;
+    m_syncInterval = std::chrono::milliseconds(syncIntervalMs);
+    m_running = true;
+    m_thread = std::thread(&StockLedger::Run, this);
+}
+
+void StockLedger::Stop()
+{
+    if (m_running) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = false;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+    }
+    if (!m_open) return;
+    std::vector<Change> changes;
+    std::vector<std::pair<PartId, int>> deltas;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        changes.swap(m_queue);
+        deltas.swap(m_queuedDeltas);
+    }
+    for (Change &c : changes) Apply(c, deltas);
+    // Compact so the next start has no log to replay
+    if (m_logRecords == 0 || !Compact()) WriteLog(true);
+    if (m_log) fclose(m_log);
+    m_log = nullptr;
+    m_open = false;
+}
+
+void StockLedger::RecordDeduction(Span<PartDemand> parts, uint32_t reportId)
+{
+    if (!m_open || parts.empty()) return;
+    std::pair<PartId, int> deltas[16];
+    std::vector<std::pair<PartId, int>> more;
+    std::pair<PartId, int> *out = deltas;
+    if (parts.size() > 16) {
+        more.resize(parts.size());
+        out = more.data();
+    }
+    for (size_t i = 0; i < parts.size(); i++) out[i] = {parts[i].part, -parts[i].quantity};
+    Queue(Change{Change::Deduction, reportId, 0, 0, {}}, out, parts.size());
+}
+
+void StockLedger::RecordRestock(std::vector<std::pair<PartId, int>> deltas,
+                                std::vector<std::pair<PartId, int>> file)
+{
+    if (!m_open) return;
+    Queue(Change{Change::Restock, 0, 0, 0, std::move(file)}, deltas.data(), deltas.size());
+}
+
+void StockLedger::RecordReset(std::vector<std::pair<PartId, int>> file)
+{
+    if (!m_open) return;
+    Queue(Change{Change::Reset, 0, 0, 0, std::move(file)}, nullptr, 0);
+}
+
+void StockLedger::Queue(Change change, const std::pair<PartId, int> *deltas, size_t count)
+{
+    bool wasEmpty;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        wasEmpty = m_queue.empty();
+        change.firstDelta = m_queuedDeltas.size();
+        change.deltaCount = count;
+        m_queuedDeltas.insert(m_queuedDeltas.end(), deltas, deltas + count);
+        m_queue.push_back(std::move(change));
+    }
+    // The writer only sleeps on an empty queue
+    if (wasEmpty) m_wake.notify_one();
+}
+
+// Writer thread: the first queued change starts a short group window; what
+// is queued by its end is applied and written in one go. Syncs happen at most
+// once per interval.
+void StockLedger::Run()
+{
+    auto lastSync = std::chrono::steady_clock::now();
+    bool unsynced = false;
+    std::vector<Change> changes;
+    std::vector<std::pair<PartId, int>> deltas;
+    for (;;) {
+        bool running;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait_for(lock, m_syncInterval, [this] { return !m_queue.empty() || !m_running; });
+            if (m_running && !m_queue.empty()) {
+                lock.unlock();
+                std::this_thread::sleep_for(kLedgerGroupWindow);
+                lock.lock();
+            }
+            running = m_running;
+            changes.swap(m_queue);
+            deltas.swap(m_queuedDeltas);
+        }
+        for (Change &c : changes) Apply(c, deltas);
+        changes.clear();
+        deltas.clear();
+        if (!m_pending.empty()) {
+            WriteLog(false);
+            unsynced = true;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (unsynced && (!running || now - lastSync >= m_syncInterval)) {
+            if (m_log) SyncFile(m_log);
+            unsynced = false;
+            lastSync = now;
+        }
+        if (m_logRecords >= kLedgerCompactRecords) {
+            if (Compact()) unsynced = false;
+            else m_logRecords = 0; // try again after as many more
+        }
+        if (!running) break; // Stop() takes what was queued after this
+    }
+}
+
+void StockLedger::Apply(Change &change, const std::vector<std::pair<PartId, int>> &deltas)
+{
+    for (size_t i = 0; i < change.deltaCount; i++) {
+        AddLive(deltas[change.firstDelta + i].first, deltas[change.firstDelta + i].second);
+    }
+    switch (change.kind) {
+    case Change::Deduction:
+        AppendDeduction(change, deltas);
+        break;
+    case Change::Restock:
+        // The stock.txt baseline only lives in snapshots
+        m_file = std::move(change.file);
+        Compact();
+        break;
+    case Change::Reset:
+        m_live.clear();
+        for (auto &q : change.file) AddLive(q.first, q.second);
+        m_file = std::move(change.file);
+        Compact();
+        break;
+    }
+}
+
+void StockLedger::AppendDeduction(const Change &change, const std::vector<std::pair<PartId, int>> &deltas)
+{
+    m_payload.clear();
+    uint32_t head[2] = {change.reportId, static_cast<uint32_t>(change.deltaCount)};
+    m_payload.append(reinterpret_cast<const char*>(head), sizeof(head));
+    for (size_t i = 0; i < change.deltaCount; i++) {
+        auto &d = deltas[change.firstDelta + i];
+        uint32_t name = LogName(d.first);
+        int32_t delta = d.second;
+        m_payload.append(reinterpret_cast<const char*>(&name), 4);
+        m_payload.append(reinterpret_cast<const char*>(&delta), 4);
+    }
+    AppendJournalEntry(m_pending, kLedgerDeduction, m_payload);
+    m_logRecords++;
+}
+
+// The part's name id in the current log, adding its name entry on first use
+uint32_t StockLedger::LogName(PartId part)
+{
+    if (part >= m_logNames.size()) m_logNames.resize(part + 1, kNoPart);
+    if (m_logNames[part] == kNoPart) {
+        m_logNames[part] = m_logNameCount++;
+        AppendJournalEntry(m_pending, kLedgerName, g_partRegistry.Name(part));
+    }
+    return m_logNames[part];
+}
+
+// Snapshot the stock and start a new log after it. The log bytes not written
+// yet are covered by the snapshot.
+bool StockLedger::Compact()
+{
+    m_generation++;
+    if (!WriteSnapshot()) {
+        m_generation--;
+        LogWarning("Could not write the stock snapshot " + m_snapshotFile);
+        return false;
+    }
+    m_pending.clear();
+    m_logRecords = 0;
+    return StartLog();
+}
+
+bool StockLedger::WriteSnapshot()
+{
+    // Every part with a quantity or a stock.txt line
+    std::map<PartId, std::pair<int32_t, int32_t>> parts;
+    for (PartId p = 0; p < m_live.size(); p++) {
+        if (m_live[p] != 0) parts[p] = {m_live[p], kNotInStockFile};
+    }
+    for (auto &q : m_file) {
+        auto it = parts.emplace(q.first, std::make_pair(0, 0)).first;
+        it->second.second = q.second;
+    }
+    std::string payload(reinterpret_cast<const char*>(&m_generation), sizeof(m_generation));
+    uint32_t count = static_cast<uint32_t>(parts.size());
+    payload.append(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (auto &p : parts) {
+        const std::string &name = g_partRegistry.Name(p.first);
+        uint16_t length = static_cast<uint16_t>(std::min<size_t>(name.size(), std::numeric_limits<uint16_t>::max()));
+        payload.append(reinterpret_cast<const char*>(&p.second.first), 4);
+        payload.append(reinterpret_cast<const char*>(&p.second.second), 4);
+        payload.append(reinterpret_cast<const char*>(&length), 2);
+        payload.append(name, 0, length);
+    }
+    std::string bytes = JournalHeaderBytes(kLedgerSnapshotMagic);
+    AppendJournalEntry(bytes, kLedgerSnapshot, payload);
+
+    std::string tmpFile = m_snapshotFile + ".tmp";
+    FILE *file = fopen(tmpFile.c_str(), "wb");
+    if (!file) return false;
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    SyncFile(file);
+    ok = fclose(file) == 0 && ok;
+    if (!ok || !RenameOver(tmpFile, m_snapshotFile)) {
+        std::remove(tmpFile.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Begin an empty log following snapshot m_generation
+bool StockLedger::StartLog()
+{
+    if (m_log) fclose(m_log);
+    m_logNames.clear();
+    m_logNameCount = 0;
+    m_log = fopen(m_logFile.c_str(), "wb");
+    if (!m_log) {
+        LogWarning("Could not write the stock ledger " + m_logFile);
+        return false;
+    }
+    std::string bytes = JournalHeaderBytes(kLedgerMagic);
+    AppendJournalEntry(bytes, kLedgerGeneration,
+                       std::string_view(reinterpret_cast<const char*>(&m_generation), sizeof(m_generation)));
+    fwrite(bytes.data(), 1, bytes.size(), m_log);
+    SyncFile(m_log);
+    return true;
+}
+
+void StockLedger::WriteLog(bool sync)
+{
+    if (m_log && !m_pending.empty()) {
+        fwrite(m_pending.data(), 1, m_pending.size(), m_log);
+        fflush(m_log);
+    }
+    m_pending.clear();
+    if (m_log && sync) SyncFile(m_log);
+}
+
+void ReadStock(const std::string &stockFile, LoadedStock &stock)
+{
+    ScopedTimer timer(Metric::StockLoad);
+    stock = LoadedStock();
+    if (!g_stockLedger.Open(stockFile + ".wal", stockFile + ".snap", stock)) {
+        LogWarning("Could not open the stock ledger " + stockFile + ".wal; deductions will not survive a restart");
+    }
+    stock.fileRead = ReadStockFile(stockFile, stock.file);
+}
+
+bool ApplyStock(LoadedStock &&stock)
+{
+    if (stock.restored) {
+        stockInventory.Reset(g_partRegistry.Size());
+        for (auto &q : stock.live) stockInventory.SetQuantity(q.first, q.second);
+        stockFileQuantities = std::move(stock.baseline);
+        RebuildStockParts();
+        // stock.txt edits made since are restocks
+        if (stock.fileRead) {
+            std::vector<PartId> changed;
+            MergeStockFile(std::move(stock.file), changed);
+        }
+    } else if (stock.fileRead) {
+        ApplyStockFile(std::move(stock.file));
+    }
+    g_stockLedger.Start(kReportSyncIntervalMs);
+    return stock.restored || stock.fileRead;
+}
+
+// --------------------------- Work Orders ---------------------------
+
+bool ParseWorkOrder(std::string_view line, WorkOrder &order)
+{
+    std::string_view fields[3];
+    if (SplitFields(line, '|', fields, 3) < 3) return false;
+    order.aircraft.assign(fields[0]);
+    order.system.assign(fields[1]);
+    order.task.assign(fields[2]);
+    return true;
+}
+
+// Read a work-order file, one "aircraft|system|task" line per completed card
+bool LoadWorkOrdersFromFile(const std::string &filename, std::vector<WorkOrder> &orders)
+{
+    MappedFile file;
+    if (!file.Open(filename)) {
+        LogError("Failed to open work order file: " + filename);
+        return false;
+    }
+    std::string_view data = file.View();
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t eol = data.find('\n', pos);
+        if (eol == std::string_view::npos) eol = data.size();
+        std::string_view line = data.substr(pos, eol - pos);
+        pos = eol + 1;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) continue;
+
+        WorkOrder order;
+        if (!ParseWorkOrder(line, order)) {
+            LogWarning("Invalid work order format: " + std::string(line));
+            continue;
+        }
+        orders.push_back(std::move(order));
+    }
+    return true;
+}
+
+DeductResult DeductStock(Span<PartDemand> demands, std::vector<PartId> *shortParts, uint32_t *unsettled)
+{
+    ScopedTimer timer(Metric::StockDeduct);
+    if (g_inventoryClient.Active()) {
+        return g_inventoryClient.Deduct(demands, shortParts, unsettled);
+    }
+    // Reserve everything or nothing, then make the deduction final
+    StockInventory::Reservation reservation;
+    if (!stockInventory.Reserve(demands, reservation, shortParts)) {
+        return DeductResult::Short;
+    }
+    stockInventory.Commit(reservation);
+    return DeductResult::Done;
+}
+
+bool CheckAndDeductParts(Span<PartDemand> parts)
+{
+    return DeductStock(parts) == DeductResult::Done;
+}
+
+static const uint32_t kMinReportIdBlock = 100;
+static const uint32_t kMaxReportIdBlock = 65536;
+static const auto     kReportIdBlockGrowth = std::chrono::seconds(1); // a block used up faster doubles
+
+ReportIdAllocator g_reportIds;
+
+// Replace the mark file with 'mark' and sync it
+static bool WriteReportIdMark(const std::string &filename, uint32_t mark)
+{
+    std::string tmpFile = filename + ".tmp";
+    FILE *file = fopen(tmpFile.c_str(), "wb");
+    if (!file) return false;
+    bool ok = fprintf(file, "%u\n", mark) > 0;
+    SyncFile(file);
+    ok = fclose(file) == 0 && ok;
+    if (!ok || !RenameOver(tmpFile, filename)) {
+        std::remove(tmpFile.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ReportIdAllocator::Open(const std::string &filename, uint32_t lastUsed)
+{
+    m_filename = filename;
+    uint32_t mark = 0;
+    std::ifstream ifs(filename);
+    bool found = static_cast<bool>(ifs >> mark);
+    // After a clean Stop() the mark is the first unused id, after a crash
+    // the end of the block that was in use
+    uint32_t next = std::max<uint32_t>({mark, lastUsed + 1, 1001});
+    m_next.store(next);
+    m_limit.store(next); // the first Next() reserves a block
+    m_mark = mark;
+    m_blockSize = 0;
+    if (!found) {
+        // Claim the file now, so a mark that cannot be written shows up at startup
+        if (!WriteReportIdMark(filename, next)) {
+            LogWarning("Could not write " + filename + "; report ids may repeat after a restart");
+            return false;
+        }
+        m_mark = next;
+    }
+    return true;
+}
+
+void ReportIdAllocator::Stop()
+{
+    std::lock_guard<std::mutex> lock(m_blockMutex);
+    // A Next() whose increment comes after the read below sees the lowered
+    // limit and waits here for a new block
+    m_limit.store(0);
+    uint32_t next = m_next.load();
+    if (!m_filename.empty() && next != m_mark) {
+        if (WriteReportIdMark(m_filename, next)) {
+            m_mark = next;
+        } else {
+            LogWarning("Could not write " + m_filename + "; the rest of the report id block is skipped");
+        }
+    }
+    m_limit.store(next);
+    m_blockSize = 0;
+}
+
+// Slow path: 'id' is past the reserved block. Threads that got ids beyond it
+// meanwhile wait here until the block covering them is reserved.
+uint32_t ReportIdAllocator::NextBlock(uint32_t id)
+{
+    std::lock_guard<std::mutex> lock(m_blockMutex);
+    uint32_t limit = m_limit.load(std::memory_order_relaxed);
+    while (id >= limit) {
+        auto now = std::chrono::steady_clock::now();
+        m_blockSize = m_blockSize && now - m_lastBlock < kReportIdBlockGrowth
+                          ? std::min(m_blockSize * 2, kMaxReportIdBlock) : kMinReportIdBlock;
+        m_lastBlock = now;
+        limit = std::max(limit, id) + m_blockSize;
+        if (!m_filename.empty()) {
+            if (WriteReportIdMark(m_filename, limit)) m_mark = limit;
+            else LogWarning("Could not write " + m_filename + "; report ids may repeat after a restart");
+        }
+        m_limit.store(limit);
+    }
+    return id;
+}
+
+uint32_t NextReportId()
+{
+    return g_reportIds.Next();
+}
+
+// FormatReport without the summary. The report is filled into one object
+// per thread, so its strings keep their buffers from report to report; it
+// is valid until the next call on the same thread.
+static const MaintenanceReport& RecordReport(uint32_t reportId, uint32_t date, const std::string &aircraft,
+                                             const std::string &system, const Task &task, ReportBatch &out)
+{
+    ScopedTimer timer(Metric::ReportFormat);
+    static thread_local MaintenanceReport report;
+    report.id = reportId;
+    report.date = date;
+    report.aircraft = aircraft;
+    report.system = system;
+    report.task = task.name;
+    report.parts.resize(task.requiredParts.size());
+    for (size_t i = 0; i < task.requiredParts.size(); i++) {
+        report.parts[i].first = g_partRegistry.Name(task.requiredParts[i].part);
+        report.parts[i].second = task.requiredParts[i].quantity;
+    }
+    RenderReportText(report, out.text);
+    g_reportJournal.Record(report, out);
+    g_stockLedger.RecordDeduction(task.requiredParts, reportId);
+    return report;
+}
+
+ReportRecord FormatReport(uint32_t reportId, uint32_t date, const std::string &aircraft,
+                          const std::string &system, const Task &task, ReportBatch &out)
+{
+    return SummarizeReport(RecordReport(reportId, date, aircraft, system, task, out));
+}
+
+ReportRecord AppendReport(const std::string &aircraft, const std::string &system,
+                          const Task &task, uint64_t *textOffset)
+{
+    ReportBatch batch;
+    ReportRecord rec = FormatReport(NextReportId(), g_clock.Today(),
+                                    aircraft, system, task, batch);
+
+    // Save to file on the report writer thread
+    uint64_t offset = g_reportWriter.Submit(std::move(batch));
+    if (textOffset) *textOffset = offset;
+    return rec;
+}
+
+TaskHandle WorkOrderResolver::Resolve(const WorkOrder &order, std::string &error)
+{
+    TaskCatalog::TaskList tasks = m_catalog->Find(order.system);
+    if (tasks.empty()) {
+        error = "Unknown system: " + order.system;
+        return TaskHandle{};
+    }
+    auto &names = m_names[order.system];
+    if (names.empty()) {
+        for (size_t i=0; i<tasks.size(); i++) names.emplace(tasks[i].name, i);
+    }
+    auto task = names.find(order.task);
+    if (task == names.end()) {
+        error = "Unknown task: " + order.system + " / " + order.task;
+        return TaskHandle{};
+    }
+    return TaskHandle(m_catalog, tasks, task->second);
+}
+
+// Total demand of 'cards', one entry per part; 'totals' by PartId
+static std::vector<PartDemand> CardDemand(const std::vector<CompletedCard> &cards, std::vector<int> &totals)
+{
+    totals.assign(g_partRegistry.Size(), 0);
+    std::vector<PartDemand> demand;
+    for (auto &card : cards) {
+        for (auto &d : card.task->requiredParts) {
+            if (totals[d.part] == 0) demand.push_back({d.part, 0});
+            totals[d.part] += d.quantity;
+        }
+    }
+    for (auto &d : demand) d.quantity = totals[d.part];
+    return demand;
+}
+
+// Reports of cards whose parts are deducted, submitted as one block
+static void SubmitReports(const std::vector<CompletedCard> &cards, BatchResult &result)
+{
+    uint32_t date = g_clock.Today();
+    ReportBatch batch;
+    result.reports.reserve(cards.size());
+    for (auto &card : cards) {
+        uint64_t before = batch.text.size();
+        ReportRecord rec = FormatReport(NextReportId(), date, card.aircraft, card.system, *card.task, batch);
+        result.reports.push_back({std::move(rec), before});
+    }
+    uint64_t offset = g_reportWriter.Submit(std::move(batch));
+    for (auto &report : result.reports) report.second += offset;
+    result.completed = cards.size();
+}
+
+BatchResult CompleteBatch(const std::vector<WorkOrder> &orders)
+{
+    BatchResult result;
+    WorkOrderResolver resolver(CatalogSnapshot());
+    std::vector<CompletedCard> cards;
+    cards.reserve(orders.size());
+    std::string error;
+    for (auto &order : orders) {
+        TaskHandle task = resolver.Resolve(order, error);
+        if (!task) {
+            result.error += error + "\n";
+            continue;
+        }
+        cards.push_back({order.aircraft, order.system, std::move(task)});
+    }
+    if (cards.empty()) return result;
+
+    std::vector<int> totals;
+    std::vector<PartDemand> demand = CardDemand(cards, totals);
+    std::vector<PartId> shortParts;
+    DeductResult deducted = DeductStock(demand, &shortParts, &result.unsettled);
+    if (deducted == DeductResult::Offline) {
+        result.error += "The stock server is not reachable; nothing was deducted.\n";
+        return result;
+    }
+    if (deducted == DeductResult::Unknown) {
+        result.error += "The stock server did not confirm the deduction. The cards are reported once it "
+                        "answers whether their parts were deducted.\n";
+        result.held = std::move(cards);
+        return result;
+    }
+    if (deducted == DeductResult::Short) {
+        result.error += "Not enough parts in stock for this batch:\n";
+        for (PartId p : shortParts) {
+            result.error += "  " + g_partRegistry.Name(p) + ": need " + std::to_string(totals[p]) +
+                            ", have " + std::to_string(stockInventory.Quantity(p)) + "\n";
+        }
+        return result;
+    }
+    for (auto &d : demand) result.changedParts.push_back(d.part);
+    SubmitReports(cards, result);
+    return result;
+}
+
+BatchResult ReportCards(const std::vector<CompletedCard> &cards)
+{
+    BatchResult result;
+    if (cards.empty()) return result;
+    std::vector<int> totals;
+    for (auto &d : CardDemand(cards, totals)) result.changedParts.push_back(d.part);
+    SubmitReports(cards, result);
+    return result;
+}
+
+uint32_t CompleteWorkOrder(WorkOrderResolver &resolver, const WorkOrder &order, uint32_t date,
+                           ReportBatch &batch, std::string &error)
+{
+    TaskHandle task = resolver.Resolve(order, error);
+    if (!task) return 0;
+    uint32_t unsettled = 0;
+    switch (DeductStock(task->requiredParts, nullptr, &unsettled)) {
+    case DeductResult::Done:
+        break;
+    case DeductResult::Short:
+        error = "Not enough parts in stock: " + order.system + " / " + order.task;
+        return 0;
+    case DeductResult::Offline:
+        error = "Stock server not reachable";
+        return 0;
+    case DeductResult::Unknown:
+        error = "Stock server did not confirm the deduction (request " + std::to_string(unsettled) + ")";
+        return 0;
+    }
+    uint32_t id = NextReportId();
+    RecordReport(id, date, order.aircraft, order.system, *task, batch);
+    return id;
+}
+
+// --------------------------- Work Package ---------------------------
+
+void WorkPackage::Add(std::string aircraft, std::string system, TaskHandle task)
+{
+    AddDemand(task->requiredParts, 1);
+    m_tasks.push_back({std::move(aircraft), std::move(system), std::move(task)});
+}
+
+void WorkPackage::Remove(size_t index)
+{
+    AddDemand(m_tasks[index].task->requiredParts, -1);
+    m_tasks.erase(m_tasks.begin() + static_cast<std::ptrdiff_t>(index));
+}
+
+void WorkPackage::Clear()
+{
+    m_tasks.clear();
+    m_parts.clear();
+    m_slot.clear();
+    m_demand.clear();
+    m_short.clear();
+    m_shortCount = 0;
+}
+
+size_t WorkPackage::Find(const std::string &aircraft, const std::string &system, std::string_view task) const
+{
+    for (size_t i = 0; i < m_tasks.size(); i++) {
+        const PlannedTask &t = m_tasks[i];
+        if (t.task->name == task && t.system == system && t.aircraft == aircraft) return i;
+    }
+    return npos;
+}
+
+void WorkPackage::AddDemand(Span<PartDemand> parts, int sign)
+{
+    for (auto &d : parts) {
+        if (d.part >= m_demand.size()) {
+            size_t size = static_cast<size_t>(d.part) + 1;
+            m_demand.resize(size, 0);
+            m_short.resize(size, 0);
+            m_slot.resize(size, static_cast<size_t>(npos));
+        }
+        int before = m_demand[d.part];
+        m_demand[d.part] += sign * d.quantity;
+        if (before == 0 && m_demand[d.part] > 0) {
+            m_slot[d.part] = m_parts.size();
+            m_parts.push_back(d.part);
+        } else if (before > 0 && m_demand[d.part] <= 0) {
+            // Swap the last part into the freed slot
+            size_t slot = m_slot[d.part];
+            m_parts[slot] = m_parts.back();
+            m_slot[m_parts[slot]] = slot;
+            m_parts.pop_back();
+            m_slot[d.part] = npos;
+        }
+        Recheck(d.part);
+    }
+}
+
+void WorkPackage::Recheck(PartId part)
+{
+    if (part >= m_demand.size()) return; // not needed by the package
+    bool isShort = m_demand[part] > stockInventory.Quantity(part);
+    if (isShort == static_cast<bool>(m_short[part])) return;
+    m_short[part] = isShort;
+    if (isShort) m_shortCount++;
+    else m_shortCount--;
+}
+
+void WorkPackage::RecheckStock(const std::vector<PartId> &changed)
+{
+    for (PartId part : changed) Recheck(part);
+}
+
+void WorkPackage::RecheckStock()
+{
+    for (PartId part : m_parts) Recheck(part);
+}
+
+std::vector<PartDemand> StockShortfall(Span<PartDemand> demands)
+{
+    std::vector<PartDemand> missing;
+    for (auto &d : demands) {
+        int available = stockInventory.Quantity(d.part);
+        if (available < d.quantity) missing.push_back({d.part, d.quantity - available});
+    }
+    return missing;
+}
@@ -0,0 +1,1844 @@
+// MRO core: task catalog, stock, maintenance reports and work orders, with
+// no GUI dependency. Shared by the wx application (mro_wx_enhanced.cpp) and
+// the headless engine (mro_headless.cpp); implemented in mro_core.cpp.
+
+#ifndef MRO_CORE_H
+#define MRO_CORE_H
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <ctime>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+#include <deque>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <shared_mutex>
+#include <charconv>
+#include <functional>
+#include <memory>
+#include <cctype>
+#include <tuple>
+
+// --------------------------- Logging ---------------------------
+// Core code reports problems through one sink so it runs with or without a
+// GUI: the wx application forwards to wxLog, otherwise messages go to stderr.
+
+enum class LogLevel { Warning, Error };
+using LogSink = std::function<void(LogLevel, const std::string&)>;
+
+// Replace the sink; an empty sink restores stderr. Messages may come from
+// background loader threads.
+void SetLogSink(LogSink sink);
+void LogWarning(const std::string &message);
+void LogError(const std::string &message);
+
+// --------------------------- Data Structures ---------------------------
+
+// Dense integer id of a part name, assigned by the part registry
+using PartId = std::uint32_t;
+
+// One requirement of a task: a part and how many units of it
+struct PartDemand {
+    PartId part;
+    int    quantity;
+};
+
+inline bool operator==(const PartDemand &a, const PartDemand &b)
+{
+    return a.part == b.part && a.quantity == b.quantity;
+}
+
+// Read-only view of 'count' consecutive elements
+template <typename T>
+class Span
+{
+public:
+    Span() = default;
+    Span(const T *data, size_t count) : m_data(data), m_count(count) {}
+    Span(const std::vector<T> &vec) : m_data(vec.data()), m_count(vec.size()) {}
+
+    const T* data() const { return m_data; }
+    const T* begin() const { return m_data; }
+    const T* end() const { return m_data + m_count; }
+    size_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+    const T& operator[](size_t i) const { return m_data[i]; }
+
+private:
+    const T *m_data = nullptr;
+    size_t   m_count = 0;
+};
+
+template <typename T>
+inline bool operator==(const Span<T> &a, const Span<T> &b)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+// Slice of a catalog's text arena
+struct TextSpan { uint32_t offset, length; };
+
+// Layout records of a TaskCatalog; the catalog cache stores these as is
+struct SystemRecord { TextSpan name; uint32_t firstTask, taskCount; };
+struct TaskRecord   { TextSpan name; uint32_t firstStep, stepCount, firstPart, partCount, firstType, typeCount; };
+
+// A list of strings (steps, aircraft types) as views into the catalog text
+class TextList
+{
+public:
+    TextList() = default;
+    TextList(const char *text, Span<TextSpan> spans) : m_text(text), m_spans(spans) {}
+
+    size_t size() const { return m_spans.size(); }
+    bool empty() const { return m_spans.empty(); }
+    std::string_view operator[](size_t i) const
+    {
+        return std::string_view(m_text + m_spans[i].offset, m_spans[i].length);
+    }
+
+private:
+    const char     *m_text = nullptr;
+    Span<TextSpan>  m_spans;
+};
+
+inline bool operator==(const TextList &a, const TextList &b)
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i] != b[i]) return false;
+    }
+    return true;
+}
+
+// A Task with steps and required parts (each part appears once in
+// requiredParts, with its total quantity). This is a view: the text and the
+// arrays belong to its catalog, so it is only valid while the catalog lives.
+struct Task {
+    std::string_view name;
+    TextList         steps;
+    Span<PartDemand> requiredParts;
+    TextList         aircraftTypes; // types the card applies to; empty = every aircraft
+};
+
+inline bool operator==(const Task &a, const Task &b)
+{
+    return a.name == b.name && a.steps == b.steps && a.requiredParts == b.requiredParts &&
+           a.aircraftTypes == b.aircraftTypes;
+}
+
+class TaskCatalog;
+
+// Inverted index over the words of task names, steps and required part
+// names. A word is a lower-cased run of letters, digits and '-'; a
+// hyphenated word is also indexed by its pieces ("O-ring" -> "o-ring", "o",
+// "ring"). A query matches the tasks that have, for every query word, some
+// word starting with it. Words are kept sorted, so the words with a given
+// prefix are one range and so are their posting lists.
+class SearchIndex
+{
+public:
+    // The index arrays (see the catalog cache)
+    struct Layout {
+        std::string_view text;         // all words
+        Span<TextSpan>   words;        // sorted slices of 'text'
+        Span<uint32_t>   postingStart; // per word, plus one end marker
+        Span<uint32_t>   postings;     // task indices, word by word, ascending per word
+    };
+
+    // Index every task of 'catalog' (see Task Search)
+    void Build(const TaskCatalog &catalog);
+    // Use an index built earlier; 'storage' keeps the arrays alive
+    void Attach(std::shared_ptr<const void> storage, const Layout &layout, size_t taskCount)
+    {
+        m_storage = std::move(storage);
+        m_text = layout.text;
+        m_words = layout.words;
+        m_postingStart = layout.postingStart;
+        m_postings = layout.postings;
+        m_taskCount = taskCount;
+    }
+    Layout Arrays() const { return Layout{m_text, m_words, m_postingStart, m_postings}; }
+
+    // Catalog-wide indices (TaskCatalog::TaskAt) of the matching tasks, in
+    // catalog order, into 'result'; empty for a query without words. The
+    // scratch space is per thread and reused, so once 'result' and the
+    // scratch have grown a query allocates nothing.
+    void Find(std::string_view query, std::vector<uint32_t> &result) const;
+    std::vector<uint32_t> Find(std::string_view query) const
+    {
+        std::vector<uint32_t> result;
+        Find(query, result);
+        return result;
+    }
+
+    // Call fn(word) for the lower-cased words of 'text'; with 'pieces' a
+    // hyphenated word is followed by its parts
+    template <typename Fn>
+    static void ForEachWord(std::string_view text, bool pieces, Fn &&fn)
+    {
+        auto isWordChar = [](unsigned char c) { return std::isalnum(c) || c == '-' || c >= 0x80; };
+        std::string word;
+        size_t i = 0;
+        while (i < text.size()) {
+            while (i < text.size() && (!isWordChar(text[i]) || text[i] == '-')) i++;
+            size_t start = i;
+            while (i < text.size() && isWordChar(text[i])) i++;
+            size_t end = i;
+            while (end > start && text[end - 1] == '-') end--;
+            if (end == start) continue;
+
+            word.assign(text.substr(start, end - start));
+            for (char &c : word) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            fn(word);
+            if (!pieces || word.find('-') == std::string::npos) continue;
+            size_t p = 0;
+            while (p < word.size()) {
+                size_t dash = word.find('-', p);
+                if (dash == std::string::npos) dash = word.size();
+                if (dash > p) fn(word.substr(p, dash - p));
+                p = dash + 1;
+            }
+        }
+    }
+
+private:
+    std::shared_ptr<const void> m_storage;       // what the views below point into
+    std::string_view            m_text;
+    Span<TextSpan>              m_words;
+    Span<uint32_t>              m_postingStart;
+    Span<uint32_t>              m_postings;
+    size_t                      m_taskCount = 0;
+
+    // Posting range of all words starting with 'prefix'
+    void WordRange(std::string_view prefix, uint32_t &first, uint32_t &last) const
+    {
+        auto text = [this](const TextSpan &w) { return std::string_view(m_text.data() + w.offset, w.length); };
+        auto lo = std::lower_bound(m_words.begin(), m_words.end(), prefix,
+                                   [&](const TextSpan &w, std::string_view p) { return text(w) < p; });
+        auto hi = std::partition_point(lo, m_words.end(), [&](const TextSpan &w) {
+            return text(w).compare(0, prefix.size(), prefix) == 0;
+        });
+        first = m_postingStart.empty() ? 0 : m_postingStart[lo - m_words.begin()];
+        last = m_postingStart.empty() ? 0 : m_postingStart[hi - m_words.begin()];
+    }
+};
+
+// Immutable task catalog, systems sorted by name. Every distinct name and
+// step text is stored once in a single text arena; tasks are fixed-size
+// records referring to it by offset, contiguous per system, and their steps
+// and parts are contiguous in the same order. The catalog only holds views
+// of its arrays: a catalog from CatalogBuilder owns them (and builds the
+// search and applicability indexes), one from the catalog cache points into
+// the mapped file, indexes included.
+class TaskCatalog
+{
+public:
+    // The tasks of one system, optionally only those whose local indices
+    // (position in the system) are listed in 'rows'
+    class TaskList
+    {
+    public:
+        class iterator
+        {
+        public:
+            iterator(const TaskList *list, size_t i) : m_list(list), m_i(i) {}
+            Task operator*() const { return (*m_list)[m_i]; }
+            iterator& operator++() { m_i++; return *this; }
+            bool operator!=(const iterator &o) const { return m_i != o.m_i; }
+
+        private:
+            const TaskList *m_list;
+            size_t          m_i;
+        };
+
+        TaskList() = default;
+        TaskList(const TaskCatalog *catalog, uint32_t first, uint32_t count, const uint32_t *rows = nullptr)
+            : m_catalog(catalog), m_first(first), m_count(count), m_rows(rows) {}
+
+        size_t size() const { return m_count; }
+        bool empty() const { return m_count == 0; }
+        Task operator[](size_t i) const { return m_catalog->TaskAt(m_first + Position(i)); }
+        iterator begin() const { return iterator(this, 0); }
+        iterator end() const { return iterator(this, m_count); }
+
+        // Position of row 'i' within its system
+        size_t Position(size_t i) const { return m_rows ? m_rows[i] : i; }
+        // Catalog-wide number of row 'i' (see TaskAt)
+        size_t TaskId(size_t i) const { return m_first + Position(i); }
+
+        // Row showing the task at 'position' within the system, or npos
+        size_t RowOf(size_t position) const
+        {
+            if (!m_rows) return position < m_count ? position : npos;
+            const uint32_t *it = std::lower_bound(m_rows, m_rows + m_count, position);
+            return it != m_rows + m_count && *it == position ? static_cast<size_t>(it - m_rows) : npos;
+        }
+
+    private:
+        const TaskCatalog *m_catalog = nullptr;
+        uint32_t           m_first = 0;
+        uint32_t           m_count = 0;
+        const uint32_t    *m_rows = nullptr;
+    };
+
+    static const size_t npos = static_cast<size_t>(-1);
+
+    // Every array of a catalog (see the catalog cache)
+    struct Layout {
+        std::string_view    text;
+        Span<SystemRecord>  systems;
+        Span<TaskRecord>    tasks;
+        Span<TextSpan>      steps;
+        Span<PartDemand>    parts;
+        Span<TextSpan>      types;
+        Span<TextSpan>      aircraftTypes;   // applicability index
+        Span<uint32_t>      applicableStart;
+        Span<uint32_t>      applicable;
+        SearchIndex::Layout search;
+    };
+
+    TaskCatalog() = default;
+    // Take the arrays and build the indexes over them
+    TaskCatalog(std::string text, std::vector<SystemRecord> systems, std::vector<TaskRecord> tasks,
+                std::vector<TextSpan> steps, std::vector<PartDemand> parts, std::vector<TextSpan> types);
+    // Use 'layout' as it is; 'storage' keeps the arrays alive
+    TaskCatalog(std::shared_ptr<const void> storage, const Layout &layout);
+
+    size_t SystemCount() const { return m_systems.size(); }
+    std::string_view SystemName(size_t s) const { return Text(m_systems[s].name); }
+    TaskList SystemTasks(size_t s) const
+    {
+        return TaskList(this, m_systems[s].firstTask, m_systems[s].taskCount);
+    }
+
+    // Index of system 'name', or npos
+    size_t FindSystem(std::string_view name) const
+    {
+        auto it = std::lower_bound(m_systems.begin(), m_systems.end(), name,
+                                   [this](const SystemRecord &s, std::string_view n) { return Text(s.name) < n; });
+        if (it == m_systems.end() || Text(it->name) != name) return npos;
+        return static_cast<size_t>(it - m_systems.begin());
+    }
+
+    // Tasks of system 'name'; empty if the catalog has no such system
+    TaskList Find(std::string_view name) const
+    {
+        size_t s = FindSystem(name);
+        return s == npos ? TaskList() : SystemTasks(s);
+    }
+
+    // The tasks of system 'name' that apply to 'aircraftType' (all of them if
+    // the type is empty). A type no card names sees the unrestricted cards.
+    TaskList Find(std::string_view name, std::string_view aircraftType) const
+    {
+        if (aircraftType.empty()) return Find(name);
+        size_t s = FindSystem(name);
+        if (s == npos) return TaskList();
+        size_t type = FindAircraftType(aircraftType);
+        size_t bucket = (type == npos ? 0 : type + 1) * m_systems.size() + s;
+        uint32_t begin = m_applicableStart[bucket];
+        return TaskList(this, m_systems[s].firstTask, m_applicableStart[bucket + 1] - begin,
+                        m_applicable.data() + begin);
+    }
+
+    // Does catalog-wide task 't' apply to 'aircraftType' (empty: any)?
+    bool AppliesTo(size_t t, std::string_view aircraftType) const
+    {
+        const TaskRecord &r = m_tasks[t];
+        if (aircraftType.empty() || r.typeCount == 0) return true;
+        for (uint32_t i = 0; i < r.typeCount; i++) {
+            if (Text(m_types[r.firstType + i]) == aircraftType) return true;
+        }
+        return false;
+    }
+
+    // Index of an aircraft type named by some card, or npos
+    size_t FindAircraftType(std::string_view type) const
+    {
+        auto it = std::lower_bound(m_aircraftTypes.begin(), m_aircraftTypes.end(), type,
+                                   [this](const TextSpan &t, std::string_view n) { return Text(t) < n; });
+        if (it == m_aircraftTypes.end() || Text(*it) != type) return npos;
+        return static_cast<size_t>(it - m_aircraftTypes.begin());
+    }
+
+    size_t TaskCount() const { return m_tasks.size(); }
+
+    // System index of catalog-wide task index 't'
+    size_t SystemOf(size_t t) const
+    {
+        auto it = std::upper_bound(m_systems.begin(), m_systems.end(), t,
+                                   [](size_t task, const SystemRecord &s) { return task < s.firstTask; });
+        return static_cast<size_t>(it - m_systems.begin()) - 1;
+    }
+
+    const SearchIndex &Search() const { return m_search; }
+
+    Task TaskAt(size_t t) const
+    {
+        const TaskRecord &r = m_tasks[t];
+        return Task{Text(r.name),
+                    TextList(m_text.data(), Span<TextSpan>(m_steps.data() + r.firstStep, r.stepCount)),
+                    Span<PartDemand>(m_parts.data() + r.firstPart, r.partCount),
+                    TextList(m_text.data(), Span<TextSpan>(m_types.data() + r.firstType, r.typeCount))};
+    }
+
+    // Raw layout (see the catalog cache)
+    Layout Arrays() const
+    {
+        return Layout{m_text, m_systems, m_tasks, m_steps, m_parts, m_types,
+                      m_aircraftTypes, m_applicableStart, m_applicable, m_search.Arrays()};
+    }
+
+private:
+    std::shared_ptr<const void> m_storage; // what the views below point into
+    std::string_view   m_text;    // text arena
+    Span<SystemRecord> m_systems;
+    Span<TaskRecord>   m_tasks;
+    Span<TextSpan>     m_steps;
+    Span<PartDemand>   m_parts;
+    Span<TextSpan>     m_types;   // applicability of each task
+    SearchIndex        m_search;
+
+    // Applicability index: for every (type slot, system) bucket the sorted
+    // positions of the tasks that apply. Slot 0 holds the unrestricted tasks
+    // (for types no card names), slot k+1 those for m_aircraftTypes[k].
+    Span<TextSpan>     m_aircraftTypes;   // distinct, sorted
+    Span<uint32_t>     m_applicableStart; // per bucket, plus one end marker
+    Span<uint32_t>     m_applicable;
+
+    std::string_view Text(TextSpan span) const
+    {
+        return std::string_view(m_text.data() + span.offset, span.length);
+    }
+
+    // Fill the applicability index arrays (m_aircraftTypes is pointed at
+    // 'aircraftTypes' on the way)
+    void BuildApplicability(std::vector<TextSpan> &aircraftTypes, std::vector<uint32_t> &applicableStart,
+                            std::vector<uint32_t> &applicable);
+};
+
+// Collects tasks for a new TaskCatalog. Text is referenced, not copied, so
+// everything passed in must stay valid until Build() returns. Within a
+// system the tasks keep the order they were added in.
+class CatalogBuilder
+{
+public:
+    // Start a task; AddStep(), AddPart() and AddAircraftType() fill it in
+    void BeginTask(std::string_view system, std::string_view name)
+    {
+        auto it = m_systemIndex.emplace(system, m_systemNames.size());
+        if (it.second) {
+            m_systemNames.push_back(system);
+            m_drafts.emplace_back();
+        }
+        m_current = it.first->second;
+        m_drafts[m_current].push_back({name, static_cast<uint32_t>(m_steps.size()), 0,
+                                       static_cast<uint32_t>(m_parts.size()), 0,
+                                       static_cast<uint32_t>(m_types.size()), 0});
+    }
+
+    void AddStep(std::string_view step)
+    {
+        m_steps.push_back(step);
+        m_drafts[m_current].back().stepCount++;
+    }
+
+    // Repeats of a part add up
+    void AddPart(PartId part, int quantity)
+    {
+        Draft &draft = m_drafts[m_current].back();
+        for (size_t i = draft.firstPart; i < m_parts.size(); i++) {
+            if (m_parts[i].part == part) {
+                m_parts[i].quantity += quantity;
+                return;
+            }
+        }
+        m_parts.push_back({part, quantity});
+        draft.partCount++;
+    }
+
+    // Restrict the task to an aircraft type (it applies to all of the types
+    // added); repeats are ignored
+    void AddAircraftType(std::string_view type)
+    {
+        Draft &draft = m_drafts[m_current].back();
+        for (size_t i = draft.firstType; i < m_types.size(); i++) {
+            if (m_types[i] == type) return;
+        }
+        m_types.push_back(type);
+        draft.typeCount++;
+    }
+
+    // Copy every task of 'catalog' (which must outlive Build())
+    void AddCatalog(const TaskCatalog &catalog)
+    {
+        for (size_t s = 0; s < catalog.SystemCount(); s++) {
+            std::string_view system = catalog.SystemName(s);
+            for (Task t : catalog.SystemTasks(s)) {
+                BeginTask(system, t.name);
+                for (size_t i = 0; i < t.steps.size(); i++) AddStep(t.steps[i]);
+                for (const PartDemand &d : t.requiredParts) AddPart(d.part, d.quantity);
+                for (size_t i = 0; i < t.aircraftTypes.size(); i++) AddAircraftType(t.aircraftTypes[i]);
+            }
+        }
+    }
+
+    // Add the tasks of 'other' after this builder's, mapping its part ids
+    // through 'partIds'
+    void Append(const CatalogBuilder &other, const std::vector<PartId> &partIds)
+    {
+        uint32_t stepBase = static_cast<uint32_t>(m_steps.size());
+        uint32_t partBase = static_cast<uint32_t>(m_parts.size());
+        uint32_t typeBase = static_cast<uint32_t>(m_types.size());
+        m_steps.insert(m_steps.end(), other.m_steps.begin(), other.m_steps.end());
+        m_types.insert(m_types.end(), other.m_types.begin(), other.m_types.end());
+        for (const PartDemand &d : other.m_parts) m_parts.push_back({partIds[d.part], d.quantity});
+        for (size_t s = 0; s < other.m_systemNames.size(); s++) {
+            auto it = m_systemIndex.emplace(other.m_systemNames[s], m_systemNames.size());
+            if (it.second) {
+                m_systemNames.push_back(other.m_systemNames[s]);
+                m_drafts.emplace_back();
+            }
+            std::vector<Draft> &bucket = m_drafts[it.first->second];
+            bucket.reserve(bucket.size() + other.m_drafts[s].size());
+            for (Draft d : other.m_drafts[s]) {
+                d.firstStep += stepBase;
+                d.firstPart += partBase;
+                d.firstType += typeBase;
+                bucket.push_back(d);
+            }
+        }
+    }
+
+    // Lay the tasks out as a catalog. Returns null if the distinct text
+    // exceeds the 4 GiB the arena offsets can address.
+    std::shared_ptr<const TaskCatalog> Build() const
+    {
+        std::vector<size_t> order(m_systemNames.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = i;
+        std::sort(order.begin(), order.end(),
+                  [this](size_t a, size_t b) { return m_systemNames[a] < m_systemNames[b]; });
+
+        std::string text;
+        std::unordered_map<std::string_view, TextSpan> interned;
+        bool overflow = false;
+        auto intern = [&](std::string_view str) {
+            auto it = interned.find(str);
+            if (it != interned.end()) return it->second;
+            if (text.size() + str.size() > std::numeric_limits<uint32_t>::max()) overflow = true;
+            TextSpan span{static_cast<uint32_t>(text.size()), static_cast<uint32_t>(str.size())};
+            text.append(str);
+            interned.emplace(str, span);
+            return span;
+        };
+
+        std::vector<SystemRecord> systems;
+        std::vector<TaskRecord>   tasks;
+        std::vector<TextSpan>     steps;
+        std::vector<PartDemand>   parts;
+        std::vector<TextSpan>     types;
+        systems.reserve(order.size());
+        steps.reserve(m_steps.size());
+        parts.reserve(m_parts.size());
+        for (size_t s : order) {
+            systems.push_back({intern(m_systemNames[s]), static_cast<uint32_t>(tasks.size()),
+                               static_cast<uint32_t>(m_drafts[s].size())});
+            for (const Draft &d : m_drafts[s]) {
+                tasks.push_back({intern(d.name), static_cast<uint32_t>(steps.size()), d.stepCount,
+                                 static_cast<uint32_t>(parts.size()), d.partCount,
+                                 static_cast<uint32_t>(types.size()), d.typeCount});
+                for (uint32_t i = 0; i < d.stepCount; i++) steps.push_back(intern(m_steps[d.firstStep + i]));
+                parts.insert(parts.end(), m_parts.begin() + d.firstPart,
+                             m_parts.begin() + d.firstPart + d.partCount);
+                for (uint32_t i = 0; i < d.typeCount; i++) types.push_back(intern(m_types[d.firstType + i]));
+            }
+        }
+        if (overflow) return nullptr;
+        text.shrink_to_fit();
+        return std::make_shared<const TaskCatalog>(std::move(text), std::move(systems), std::move(tasks),
+                                                   std::move(steps), std::move(parts), std::move(types));
+    }
+
+private:
+    // A task being collected; steps, parts and types index m_steps / m_parts / m_types
+    struct Draft {
+        std::string_view name;
+        uint32_t firstStep, stepCount, firstPart, partCount, firstType, typeCount;
+    };
+
+    std::vector<std::string_view>                 m_systemNames; // first-seen order
+    std::unordered_map<std::string_view, size_t>  m_systemIndex;
+    std::vector<std::vector<Draft>>               m_drafts;      // per system
+    std::vector<std::string_view>                 m_steps;
+    std::vector<PartDemand>                       m_parts;
+    std::vector<std::string_view>                 m_types;
+    size_t                                        m_current = 0; // system of the open task
+};
+
+// Global catalog snapshot. A published snapshot is never modified: reloading
+// builds a new one and swaps it in atomically, and whoever still holds the old
+// snapshot (through its shared_ptr) keeps it alive.
+std::shared_ptr<const TaskCatalog> CatalogSnapshot();
+void PublishCatalog(std::shared_ptr<const TaskCatalog> catalog);
+
+// Reference to one task inside a catalog snapshot: passing it around never
+// copies the task's steps or parts. The handle keeps its snapshot alive, so
+// it stays valid across reloads.
+struct TaskHandle {
+    std::shared_ptr<const TaskCatalog> catalog;
+    Task   task;
+    size_t index = 0; // position in its system's task list
+    size_t id = 0;    // catalog-wide task number (TaskCatalog::TaskAt)
+
+    TaskHandle() = default;
+    TaskHandle(std::shared_ptr<const TaskCatalog> snapshot, const TaskCatalog::TaskList &tasks, size_t i)
+        : catalog(std::move(snapshot)), task(tasks[i]), index(i), id(tasks.TaskId(i)) {}
+
+    explicit operator bool() const { return catalog != nullptr; }
+    const Task& operator*() const { return task; }
+    const Task* operator->() const { return &task; }
+};
+
+// Parts listed in "stock.txt", in name order (display order)
+extern std::vector<PartId> stockParts;
+
+// One aircraft of the fleet file ("aircraft.txt"): tail number and type
+struct Aircraft {
+    std::string tail;
+    std::string type;
+
+    // "TC-JFA (Boeing 737-800)", or whichever of the two is set
+    std::string Label() const
+    {
+        if (tail.empty()) return type;
+        if (type.empty()) return tail;
+        return tail + " (" + type + ")";
+    }
+};
+
+// --------------------------- Helper Functions ---------------------------
+
+// Part name <-> PartId table shared by stock.txt and tasks.txt.
+// Ids are dense and handed out in first-seen order, so per-part data can live
+// in flat vectors indexed by id. Ids are never reused or removed, so they stay
+// stable across reloads; the table may grow from background loader threads.
+class PartRegistry
+{
+public:
+    PartId Intern(std::string_view name)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            auto it = m_ids.find(name);
+            if (it != m_ids.end()) return it->second;
+        }
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        auto it = m_ids.find(name);
+        if (it != m_ids.end()) return it->second;
+        PartId id = static_cast<PartId>(m_names.size());
+        m_names.emplace_back(name);
+        m_ids.emplace(m_names.back(), id);
+        return id;
+    }
+
+    // The returned reference stays valid: names are never moved or removed
+    const std::string& Name(PartId id) const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_names[id];
+    }
+
+    size_t Size() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_names.size();
+    }
+
+private:
+    mutable std::shared_mutex m_mutex;
+    std::deque<std::string> m_names; // deque keeps the map's key views valid
+    std::unordered_map<std::string_view, PartId> m_ids;
+};
+
+extern PartRegistry g_partRegistry;
+
+// Display text of a requirement: "Part" for one unit, "Part x3" otherwise
+std::string PartLabel(const std::string &name, int quantity);
+std::string PartLabel(const PartDemand &d);
+
+// --------------------------- Stock Inventory ---------------------------
+// Stock quantities per PartId, safe to use from several threads at once.
+// Every part has its own atomic counters, so reservations touching different
+// parts never contend; the shared lock only excludes growing the tables.
+// Reserve() takes the units out of the available stock immediately (one
+// lookup per requirement); Commit() makes the deduction final and Rollback()
+// puts the units back.
+
+class StockInventory
+{
+public:
+    // Units taken by a successful Reserve() that are not committed yet
+    class Reservation
+    {
+    public:
+        Reservation() = default;
+        Reservation(const Reservation&) = delete;
+        Reservation& operator=(const Reservation&) = delete;
+        Reservation(Reservation &&other) noexcept
+            : m_owner(other.m_owner), m_parts(std::move(other.m_parts))
+        {
+            other.m_owner = nullptr;
+        }
+        // An abandoned reservation gives its units back
+        ~Reservation() { if (m_owner) m_owner->Rollback(*this); }
+
+        bool Active() const { return m_owner != nullptr; }
+        const std::vector<PartDemand>& Parts() const { return m_parts; }
+
+    private:
+        friend class StockInventory;
+        StockInventory          *m_owner = nullptr;
+        std::vector<PartDemand>  m_parts;
+    };
+
+    // Set every quantity to zero and make room for 'partCount' parts
+    void Reset(size_t partCount)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_tableMutex);
+        for (auto &q : m_available) q.store(0, std::memory_order_relaxed);
+        for (auto &q : m_reserved) q.store(0, std::memory_order_relaxed);
+        GrowLocked(partCount);
+    }
+
+    void SetQuantity(PartId id, int quantity)
+    {
+        EnsureSize(id + 1);
+        std::shared_lock<std::shared_mutex> lock(m_tableMutex);
+        m_available[id].store(quantity, std::memory_order_relaxed);
+    }
+
+    // Add (or with a negative delta, remove) available units
+    void Adjust(PartId id, int delta)
+    {
+        EnsureSize(id + 1);
+        std::shared_lock<std::shared_mutex> lock(m_tableMutex);
+        m_available[id].fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    // Units available for new reservations; parts without a stock entry have none
+    int Quantity(PartId id) const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_tableMutex);
+        return id < m_available.size() ? m_available[id].load(std::memory_order_relaxed) : 0;
+    }
+
+    // Units held by open reservations
+    int Reserved(PartId id) const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_tableMutex);
+        return id < m_reserved.size() ? m_reserved[id].load(std::memory_order_relaxed) : 0;
+    }
+
+    // Reserve all demands or none. On failure the parts that were short are
+    // appended to 'shortParts' (if given) and nothing is held.
+    bool Reserve(Span<PartDemand> demands, Reservation &out,
+                 std::vector<PartId> *shortParts = nullptr)
+    {
+        if (out.Active()) Rollback(out);
+        std::shared_lock<std::shared_mutex> lock(m_tableMutex);
+        size_t taken = 0;
+        bool ok = true;
+        for (; taken < demands.size(); taken++) {
+            const PartDemand &d = demands[taken];
+            if (d.part >= m_available.size() || !TryTake(m_available[d.part], d.quantity)) {
+                ok = false;
+                break;
+            }
+            m_reserved[d.part].fetch_add(d.quantity, std::memory_order_relaxed);
+        }
+        if (!ok) {
+            for (size_t i = 0; i < taken; i++) {
+                Release(demands[i]);
+            }
+            if (shortParts) {
+                for (size_t i = taken; i < demands.size(); i++) {
+                    const PartDemand &d = demands[i];
+                    if (d.part >= m_available.size() ||
+                        m_available[d.part].load(std::memory_order_relaxed) < d.quantity) {
+                        shortParts->push_back(d.part);
+                    }
+                }
+            }
+            return false;
+        }
+        out.m_owner = this;
+        out.m_parts.assign(demands.begin(), demands.end());
+        return true;
+    }
+
+    // The reserved units leave the inventory for good
+    void Commit(Reservation &res)
+    {
+        if (!res.Active()) return;
+        std::shared_lock<std::shared_mutex> lock(m_tableMutex);
+        for (const PartDemand &d : res.m_parts) {
+            m_reserved[d.part].fetch_sub(d.quantity, std::memory_order_relaxed);
+        }
+        res.m_owner = nullptr;
+    }
+
+    // The reserved units go back to the available stock
+    void Rollback(Reservation &res)
+    {
+        if (!res.Active()) return;
+        std::shared_lock<std::shared_mutex> lock(m_tableMutex);
+        for (const PartDemand &d : res.m_parts) {
+            Release(d);
+        }
+        res.m_owner = nullptr;
+    }
+
+private:
+    // std::deque never moves its elements when it grows
+    std::deque<std::atomic<int>> m_available;
+    std::deque<std::atomic<int>> m_reserved;
+    mutable std::shared_mutex    m_tableMutex;
+
+    static bool TryTake(std::atomic<int> &counter, int quantity)
+    {
+        int current = counter.load(std::memory_order_relaxed);
+        while (current >= quantity) {
+            if (counter.compare_exchange_weak(current, current - quantity, std::memory_order_acq_rel)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Release(const PartDemand &d)
+    {
+        m_reserved[d.part].fetch_sub(d.quantity, std::memory_order_relaxed);
+        m_available[d.part].fetch_add(d.quantity, std::memory_order_relaxed);
+    }
+
+    void EnsureSize(size_t partCount)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(m_tableMutex);
+            if (m_available.size() >= partCount) return;
+        }
+        std::unique_lock<std::shared_mutex> lock(m_tableMutex);
+        GrowLocked(partCount);
+    }
+
+    void GrowLocked(size_t partCount)
+    {
+        while (m_available.size() < partCount) m_available.emplace_back(0);
+        while (m_reserved.size() < partCount) m_reserved.emplace_back(0);
+    }
+};
+
+// Global stock (parts never listed in stock.txt have quantity 0)
+extern StockInventory stockInventory;
+
+// --------------------------- Loading ---------------------------
+
+// Progress callback of the loaders: fraction of the input done, 0.0 .. 1.0
+using LoadProgress = std::function<void(double)>;
+
+// Load tasks from a text file and publish them, added to the current
+// catalog, as a new snapshot
+bool LoadTasksFromFile(const std::string &filename);
+
+// Read stock.txt (part|quantity) into (PartId, quantity) pairs sorted by id;
+// a repeated part keeps the last quantity. Touches no global stock state.
+bool ReadStockFile(const std::string &filename, std::vector<std::pair<PartId, int>> &quantities);
+
+// Read the fleet file: one aircraft per line, "Tail|Type" or just "Type".
+// Touches no global state.
+bool ReadFleetFile(const std::string &filename, std::vector<Aircraft> &fleet);
+
+// Replace the live stock with quantities read by ReadStockFile
+void ApplyStockFile(std::vector<std::pair<PartId, int>> &&quantities);
+
+// Load stock from a text file (part|quantity) and restore the deductions
+// its ledger recorded (see Stock Ledger)
+bool LoadStockFromFile(const std::string &filename);
+
+// Merge a re-read stock.txt into the live stock, keeping the session's
+// deductions (see mro_core.cpp). The parts whose quantity changed are
+// appended to 'changed'. Returns true if the set of listed parts changed.
+bool MergeStockFile(std::vector<std::pair<PartId, int>> &&quantities, std::vector<PartId> &changed);
+
+// --------------------------- Clock ---------------------------
+// Local date and time for reports and logs. Today's date is cached and only
+// recomputed when the local day may have ended (at the latest every hour, so
+// clock and time zone changes are picked up), which makes Today() a time()
+// call and a compare. Local time is converted with localtime_r/localtime_s,
+// so every member can be used from any thread.
+
+class ClockService
+{
+public:
+    // Today's local date as yyyymmdd
+    uint32_t Today();
+    // Today's local date as "YYYY-MM-DD"
+    std::string TodayText();
+
+    // Local time 't' as an ISO 8601 timestamp with its UTC offset,
+    // e.g. "2026-10-14T14:05:09+03:00"
+    static std::string Timestamp(time_t t);
+    std::string Now() { return Timestamp(time(nullptr)); }
+
+private:
+    std::mutex            m_mutex;          // serializes refreshes
+    std::atomic<uint32_t> m_today{0};
+    std::atomic<int64_t>  m_validUntil{0};  // time() from which m_today may be stale
+};
+
+extern ClockService g_clock;
+
+// --------------------------- Metrics ---------------------------
+// Latencies of the hot paths, for profiling real sessions. A ScopedTimer
+// records one sample (its duration and the heap allocations made inside the
+// scope) into a ring buffer of that metric owned by the calling thread, so
+// frequent metrics never push out rare ones. Each ring has one writer and
+// relaxed atomic stores, so recording never locks or allocates. Readers (the
+// diagnostics panel, the periodic dump) scan every thread's rings and report
+// p50/p99 over the newest kMetricRingSize samples of each metric and thread,
+// plus all-time counts.
+// Allocations are only counted in a diagnostics build that links
+// mro_alloc_count.cpp, which replaces the global operator new; otherwise
+// they read as 0.
+
+enum class Metric : uint8_t {
+    CatalogLoad,  // ReadCatalog, LoadTasksFromFile
+    StockLoad,    // ReadStock, LoadStockFromFile
+    SelectSystem, // filling the task list of a system (GUI)
+    SelectTask,   // showing a selected task (GUI)
+    StepsDialog,  // building TaskStepsDialog (GUI)
+    StockDeduct,  // DeductStock
+    ReportFormat, // rendering and journaling one report
+    ReportWrite,  // one pass of the report writer over its queue
+    ReportSync,   // syncing the report files
+    Count
+};
+
+static const size_t kMetricRingSize = 1024; // samples kept per metric and thread
+
+const char* MetricName(Metric metric);
+
+// Heap allocations made by the calling thread so far; 0 unless
+// AllocationsCounted()
+uint64_t ThreadAllocations();
+bool AllocationsCounted();
+
+// Installed by mro_alloc_count.cpp during static initialization
+void SetAllocationCounter(uint64_t (*counter)());
+
+// Record one sample; any thread
+void RecordMetric(Metric metric, std::chrono::steady_clock::duration elapsed, uint64_t allocations);
+
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Metric metric)
+        : m_metric(metric), m_allocations(ThreadAllocations()), m_start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer()
+    {
+        RecordMetric(m_metric, std::chrono::steady_clock::now() - m_start, ThreadAllocations() - m_allocations);
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Metric                                m_metric;
+    uint64_t                              m_allocations;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+struct MetricStats {
+    Metric   metric = Metric::Count;
+    uint64_t calls = 0;   // since the start of the process
+    size_t   samples = 0; // recent samples the figures below are taken from
+    double   p50Us = 0;   // microseconds
+    double   p99Us = 0;
+    double   maxUs = 0;
+    double   allocationsPerCall = 0;
+};
+
+// Stats of every metric recorded so far
+std::vector<MetricStats> CollectMetrics();
+// 'stats' as a text table, one line per metric
+std::string FormatMetrics(const std::vector<MetricStats> &stats);
+
+// Append a timestamped FormatMetrics() table to 'filename' every
+// 'intervalSeconds' from a background thread, and once more when
+// StopMetricsDump() is called
+bool StartMetricsDump(const std::string &filename, int intervalSeconds);
+void StopMetricsDump();
+
+// --------------------------- Binary Catalog Cache ---------------------------
+// "<tasks file>.cat": a compiled copy of tasks.txt, see mro_core.cpp
+
+// Size and modification time of a file; a cache whose stamp of tasks.txt no
+// longer matches is stale without hashing the file
+struct FileStamp {
+    uint64_t size = 0;
+    int64_t  modified = 0; // file clock ticks
+};
+bool GetFileStamp(const std::string &filename, FileStamp &stamp);
+
+// Hash of the tasks.txt contents; the cache is only used while it matches
+uint64_t CatalogSourceHash(std::string_view text);
+
+bool WriteCatalogCache(const std::string &cacheFile, const TaskCatalog &catalog, const FileStamp &source,
+                       uint64_t sourceHash);
+std::shared_ptr<const TaskCatalog> LoadCatalogCache(const std::string &cacheFile, const FileStamp &source,
+                                                    std::string_view sourceText);
+
+// Read tasks through the catalog cache, (re)writing the cache when it is out
+// of date. Returns null on failure. Safe to call from a background thread.
+std::shared_ptr<const TaskCatalog> ReadCatalog(const std::string &filename,
+                                               const LoadProgress &progress = LoadProgress());
+
+// Read the catalog (see ReadCatalog) and publish it as the current snapshot
+bool LoadCatalog(const std::string &filename);
+
+// Build the catalog cache for 'filename' ("--compile-catalog [tasks.txt]")
+bool CompileCatalog(const std::string &filename);
+
+// --------------------------- Catalog Diff ---------------------------
+
+// What changed between two catalog snapshots
+struct CatalogDiff {
+    std::vector<std::string> changedSystems; // systems whose task list differs in any way
+    size_t addedTasks   = 0;
+    size_t removedTasks = 0;
+    size_t changedTasks = 0;                 // same name, different steps or parts
+
+    bool Empty() const { return changedSystems.empty(); }
+    bool HasSystem(const std::string &system) const
+    {
+        return std::find(changedSystems.begin(), changedSystems.end(), system) != changedSystems.end();
+    }
+};
+
+// Compare two catalogs system by system; tasks are matched by name
+CatalogDiff DiffCatalogs(const TaskCatalog &before, const TaskCatalog &after);
+
+// --------------------------- ReportWriter ---------------------------
+// Background writer for the report files. The UI thread only pushes a
+// formatted report onto a lock-free queue and returns; the writer thread keeps
+// the files open, writes everything queued in one batch and syncs it to disk
+// at most once per sync interval. Stop() drains the queue before returning.
+
+// Bytes of one submission, one string per report file
+struct ReportBatch {
+    std::string text;    // readable reports (maintenance_reports.txt)
+    std::string journal; // structured journal records
+    std::string index;   // journal index entries
+};
+
+class ReportWriter
+{
+public:
+    ~ReportWriter() { Stop(); }
+
+    // The journal files are optional; an empty name leaves that part unwritten
+    bool Start(const std::string &filename, const std::string &journalFile,
+               const std::string &indexFile, int syncIntervalMs)
+    {
+        if (m_running) return true;
+        m_filenames[0] = filename;
+        m_filenames[1] = journalFile;
+        m_filenames[2] = indexFile;
+        for (int i = 0; i < 3; i++) {
+            if (m_filenames[i].empty()) continue;
+            m_files[i] = fopen(m_filenames[i].c_str(), "ab");
+            if (!m_files[i]) {
+                CloseFiles();
+                return false;
+            }
+        }
+        fseek(m_files[0], 0, SEEK_END);
+        m_textEnd = static_cast<uint64_t>(ftell(m_files[0]));
+        m_syncInterval = std::chrono::milliseconds(syncIntervalMs);
+        m_running = true;
+        m_thread = std::thread(&ReportWriter::Run, this);
+        return true;
+    }
+
+    // Queue one report; never blocks on file I/O. Without a running writer
+    // the report is appended synchronously. Returns the offset in the report
+    // file at which batch.text starts. Submissions come from one thread at a
+    // time (the journal needs them in recorded order anyway), and the files
+    // are written in submission order, so the offsets are known up front.
+    uint64_t Submit(ReportBatch batch)
+    {
+        uint64_t offset = m_textEnd.load(std::memory_order_relaxed);
+        if (!m_running) {
+            const std::string *parts[3] = {&batch.text, &batch.journal, &batch.index};
+            for (int i = 0; i < 3; i++) {
+                if (m_filenames[i].empty() || parts[i]->empty()) continue;
+                FILE *file = fopen(m_filenames[i].c_str(), "ab");
+                if (!file) continue;
+                if (i == 0) {
+                    fseek(file, 0, SEEK_END);
+                    offset = static_cast<uint64_t>(ftell(file));
+                }
+                fwrite(parts[i]->data(), 1, parts[i]->size(), file);
+                fclose(file);
+            }
+            m_textEnd.store(offset + batch.text.size(), std::memory_order_relaxed);
+            return offset;
+        }
+        m_textEnd.store(offset + batch.text.size(), std::memory_order_relaxed);
+        Node *node = new Node{std::move(batch), m_head.load(std::memory_order_relaxed)};
+        while (!m_head.compare_exchange_weak(node->next, node,
+                                             std::memory_order_release, std::memory_order_relaxed)) {
+        }
+        m_submitted++;
+        m_wake.notify_one();
+        return offset;
+    }
+
+    // Wait until everything submitted so far has been handed to the OS, so
+    // the report files can be read back consistently
+    void Flush()
+    {
+        if (!m_running) return;
+        uint64_t target = m_submitted.load();
+        m_wake.notify_one();
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_flushed.wait(lock, [this, target] { return m_written >= target; });
+    }
+
+    const std::string& Filename() const { return m_filenames[0]; }
+
+    // Write and sync everything still queued, then close the file
+    void Stop()
+    {
+        if (!m_running) return;
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_running = false;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+        CloseFiles();
+    }
+
+private:
+    struct Node {
+        ReportBatch batch;
+        Node       *next;
+    };
+
+    // Text file, journal, journal index
+    std::string             m_filenames[3] = {"maintenance_reports.txt"};
+    FILE                   *m_files[3] = {};
+    std::atomic<uint64_t>   m_textEnd{0};    // report file size once everything submitted is written
+    std::atomic<Node*>      m_head{nullptr}; // pending reports, newest first
+    std::atomic<bool>       m_running{false};
+    std::atomic<uint64_t>   m_submitted{0};
+    uint64_t                m_written = 0;   // guarded by m_wakeMutex
+    std::chrono::milliseconds m_syncInterval{1000};
+    std::thread             m_thread;
+    std::mutex              m_wakeMutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_flushed;
+
+    void CloseFiles()
+    {
+        for (FILE *&file : m_files) {
+            if (file) fclose(file);
+            file = nullptr;
+        }
+    }
+
+    void Run()
+    {
+        auto lastSync = std::chrono::steady_clock::now();
+        bool unsynced = false;
+        for (;;) {
+            bool running;
+            {
+                std::unique_lock<std::mutex> lock(m_wakeMutex);
+                m_wake.wait_for(lock, m_syncInterval, [this] {
+                    return m_head.load(std::memory_order_relaxed) != nullptr || !m_running;
+                });
+                running = m_running;
+            }
+            size_t written = WritePending();
+            if (written) {
+                {
+                    std::lock_guard<std::mutex> lock(m_wakeMutex);
+                    m_written += written;
+                }
+                m_flushed.notify_all();
+                unsynced = true;
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (unsynced && (!running || now - lastSync >= m_syncInterval)) {
+                ScopedTimer timer(Metric::ReportSync);
+                Sync();
+                unsynced = false;
+                lastSync = now;
+            }
+            if (!running && m_head.load(std::memory_order_acquire) == nullptr) break;
+        }
+    }
+
+    // Take the whole queue at once and write it oldest-first. Returns the
+    // number of submissions written.
+    size_t WritePending()
+    {
+        Node *batch = m_head.exchange(nullptr, std::memory_order_acquire);
+        if (!batch) return 0;
+        ScopedTimer timer(Metric::ReportWrite);
+        Node *oldestFirst = nullptr;
+        while (batch) {
+            Node *next = batch->next;
+            batch->next = oldestFirst;
+            oldestFirst = batch;
+            batch = next;
+        }
+        size_t count = 0;
+        while (oldestFirst) {
+            Node *next = oldestFirst->next;
+            const ReportBatch &b = oldestFirst->batch;
+            const std::string *parts[3] = {&b.text, &b.journal, &b.index};
+            for (int i = 0; i < 3; i++) {
+                if (m_files[i]) fwrite(parts[i]->data(), 1, parts[i]->size(), m_files[i]);
+            }
+            delete oldestFirst;
+            oldestFirst = next;
+            count++;
+        }
+        for (FILE *file : m_files) {
+            if (file) fflush(file);
+        }
+        return count;
+    }
+
+    // The journal is synced before its index; the index is checked against
+    // the journal when it is opened, so either may lag after a crash
+    void Sync();
+};
+
+// Reports are group-synced to disk at most this often
+static const int kReportSyncIntervalMs = 1000;
+
+extern ReportWriter g_reportWriter;
+
+// --------------------------- Report Journal ---------------------------
+// Structured, append-only copy of every report for audit queries
+// ("maintenance_reports.jrn"). Each report is a fixed-layout record holding
+// its id, date, aircraft, system, task and parts; names are stored once, the
+// first time they are used, and referenced by id afterwards. A sidecar index
+// ("maintenance_reports.jrn.idx") repeats the names and holds one fixed-size
+// entry per report, so opening the journal reads only the index and queries
+// by date, aircraft and system are range scans over it. The readable text
+// report is a rendering of the record (RenderReportText). The file layout is
+// described in mro_core.cpp.
+
+// Summary fields of one maintenance report
+struct ReportRecord {
+    std::string id;
+    std::string date;
+    std::string aircraft;
+    std::string system;
+    std::string task;
+    std::string parts; // comma separated
+};
+
+struct JournalIndexEntry {
+    uint32_t date;
+    uint32_t aircraft;
+    uint32_t system;
+    uint32_t task;
+    uint32_t id;
+    uint32_t recordSize; // journal bytes of the report entry, header included
+    uint64_t offset;     // journal offset of the report entry
+};
+
+// One completed task card
+struct MaintenanceReport {
+    uint32_t    id = 0;
+    uint32_t    date = 0; // yyyymmdd
+    std::string aircraft;
+    std::string system;
+    std::string task;
+    std::vector<std::pair<std::string, int>> parts; // name, quantity
+};
+
+std::string ReportIdText(uint32_t id);
+
+// "YYYY-MM-DD" as yyyymmdd; 0 if the text is not such a date
+uint32_t ParseReportDate(std::string_view text);
+std::string ReportDateText(uint32_t date);
+
+// Output formats of rendered and exported reports
+enum class ReportFormat { Text, Csv, JsonLines };
+
+// "text", "csv" or "jsonl"; false for any other name
+bool ParseReportFormat(std::string_view name, ReportFormat &format);
+
+// Append 'report' to 'out' in 'format'. Fields are copied and numbers written
+// with std::to_chars straight into 'out', whose capacity grows geometrically,
+// so rendering into a reused buffer stops allocating once it is warm.
+void RenderReport(const MaintenanceReport &report, ReportFormat format, std::string &out);
+// What starts a file of 'format' (the CSV column names); nothing for the others
+void RenderReportHeader(ReportFormat format, std::string &out);
+
+// Append the readable text of 'report' to 'out' (ReportFormat::Text)
+void RenderReportText(const MaintenanceReport &report, std::string &out);
+ReportRecord SummarizeReport(const MaintenanceReport &report);
+
+class ReportJournal
+{
+public:
+    // Open the journal and its index, creating them if needed. Returns false
+    // if the journal cannot be used; Record() then does nothing.
+    bool Open(const std::string &journalFile, const std::string &indexFile);
+
+    bool IsOpen() const { return m_open; }
+    const std::string& JournalFile() const { return m_journalFile; }
+    const std::string& IndexFile() const { return m_indexFile; }
+
+    // Encode 'report' into 'batch': its journal record and index entry, after
+    // any names it uses for the first time. Batches must reach the report
+    // writer in the order they were recorded.
+    void Record(const MaintenanceReport &report, ReportBatch &batch);
+
+    size_t Size() const { return m_entries.size(); }
+    const JournalIndexEntry& Entry(uint32_t pos) const { return m_entries[pos]; }
+
+    // Highest report id in the journal, 0 if it is empty
+    uint32_t LastReportId() const
+    {
+        uint32_t last = 0;
+        for (auto &e : m_entries) last = std::max(last, e.id);
+        return last;
+    }
+    const std::string& Name(uint32_t id) const { return m_names[id]; }
+
+    // Positions of the reports dated from..to (inclusive) of one aircraft
+    // and/or system ("" matches any), in journal order
+    std::vector<uint32_t> Query(uint32_t from, uint32_t to,
+                                const std::string &aircraft, const std::string &system) const;
+
+    // Sorted distinct aircraft (or systems) that have reports
+    std::vector<std::string> Aircraft() const { return Distinct(&JournalIndexEntry::aircraft); }
+    std::vector<std::string> Systems() const { return Distinct(&JournalIndexEntry::system); }
+
+    // Read the report at 'pos' back from the journal. Reports recorded since
+    // the report writer was last flushed are not on disk yet.
+    bool Read(uint32_t pos, MaintenanceReport &out) const;
+
+    // Read the reports at 'positions' in order from a mapping of the journal
+    // and pass each to 'fn'; the report object is reused between calls.
+    // Returns false if the journal cannot be mapped, otherwise 'unreadable'
+    // counts the reports that could not be decoded.
+    bool ReadEach(const std::vector<uint32_t> &positions,
+                  const std::function<void(const MaintenanceReport&)> &fn, size_t &unreadable) const;
+
+private:
+    bool                                      m_open = false;
+    std::string                               m_journalFile;
+    std::string                               m_indexFile;
+    std::vector<std::string>                  m_names;       // by name id
+    std::vector<uint64_t>                     m_nameOffsets; // journal offset of each name entry
+    std::unordered_map<std::string, uint32_t> m_nameIds;
+    std::vector<JournalIndexEntry>            m_entries;     // journal order
+    uint64_t                                  m_journalSize = 0;
+
+    // Entry positions sorted by (aircraft, system, date), (system, date) and
+    // date. Reports recorded since the last query are merged in lazily.
+    mutable std::vector<uint32_t> m_byAircraft;
+    mutable std::vector<uint32_t> m_bySystem;
+    mutable std::vector<uint32_t> m_byDate;
+    mutable std::ifstream         m_reader;
+    mutable std::string           m_readBuffer;
+    std::string                   m_payload; // record being encoded
+
+    void AddName(std::string name, uint64_t offset)
+    {
+        m_nameIds.emplace(name, static_cast<uint32_t>(m_names.size()));
+        m_names.push_back(std::move(name));
+        m_nameOffsets.push_back(offset);
+    }
+
+    uint32_t Intern(const std::string &name, ReportBatch &batch);
+    // Decode the report entry 'bytes' (indexed by 'entry') into 'out'
+    bool Decode(std::string_view bytes, const JournalIndexEntry &entry, MaintenanceReport &out) const;
+
+    bool ValidReport(const JournalIndexEntry &e) const
+    {
+        return e.aircraft < m_names.size() && e.system < m_names.size() && e.task < m_names.size();
+    }
+
+    bool ScanJournal(std::string_view bytes, uint64_t offset, uint64_t &validEnd);
+    bool WriteIndex() const;
+    void UpdateOrders() const;
+    std::vector<std::string> Distinct(uint32_t JournalIndexEntry::*field) const;
+};
+
+extern ReportJournal g_reportJournal;
+
+// Write the journal reports at 'positions' to 'filename' in 'format'. The
+// reports are rendered into one buffer that is written out whenever it
+// fills, so exports of any size use a fixed amount of memory.
+// 'unreadable' counts the reports that could not be read back.
+bool ExportReports(const ReportJournal &journal, const std::vector<uint32_t> &positions,
+                   ReportFormat format, const std::string &filename, size_t &unreadable);
+
+// --------------------------- Inventory Service ---------------------------
+// Stock shared by several terminals. One process serves the inventory over
+// TCP (mro_headless --serve-stock) and every connected terminal keeps a
+// mirror of it in stockInventory. Deductions go to the server, which applies
+// requests one at a time, each all or nothing with a per-part shortage
+// report, and pushes the new quantities of changed parts to every terminal.
+//
+// Frames are [uint32 size][uint8 type][body], 'size' counting type and
+// body; integers are little-endian. Parts go by the server's part ids,
+// announced with their names in Welcome.
+//   client -> server
+//     Hello     uint32 version, uint64 terminal
+//     Reserve   uint32 request, uint32 n, n x {uint32 part, int32 quantity}
+//     Commit    uint32 request (of an open Reserve)
+//     Rollback  uint32 request (of an open Reserve)
+//     Deduct    as Reserve, committed at once
+//     Settle    uint32 request (committed or not on an earlier connection)
+//   server -> client
+//     Welcome   uint32 version, uint32 n, n x {uint32 part, int32 available,
+//               uint16 length, name}
+//     Result    uint32 request, uint8 status, uint32 n, n x {uint32 part, int32 available}
+//               (Ok: the request's parts afterwards; Short: the parts that were short)
+//     Update    uint32 n, n x {uint32 part, int32 available}
+// Requests may be pipelined; results come back in request order. The
+// changes of one server pass go out as a single Update, and reservations
+// left open by a client that disconnects are rolled back.
+//
+// A terminal numbers its requests itself, once per process, and names itself
+// with a random 'terminal' id in Hello. The server remembers the last
+// committed requests of every terminal, so one that lost the answer to a
+// Commit asks with Settle after reconnecting: Ok if it was committed,
+// Invalid if not, Unknown if the server no longer knows. A Hello from a
+// terminal still connected drops the old connection first (rolling its
+// reservations back), so a late Commit there cannot change the answer.
+
+enum class StockFrame : uint8_t {
+    Hello = 1, Reserve = 2, Commit = 3, Rollback = 4, Deduct = 5, Settle = 6,
+    Welcome = 0x81, Result = 0x82, Update = 0x83
+};
+enum class StockStatus : uint8_t { Ok = 0, Short = 1, Invalid = 2, Unknown = 3 };
+
+static const uint32_t kStockProtocolVersion = 2;
+static const int      kStockRequestTimeoutMs = 5000;
+static const int      kStockReconnectMs = 10000; // between reconnection attempts
+
+// Outcome of a deduction. Offline: nothing was deducted. Unknown: the stock
+// server was sent the commit but did not answer, so the parts may or may not
+// have been deducted; the request is settled once the server is reachable.
+enum class DeductResult { Done, Short, Offline, Unknown };
+
+// The settled outcome of a deduction that was Unknown: Done (deducted),
+// Offline (not deducted), or still Unknown if the server no longer knows
+struct StockSettlement {
+    uint32_t     request;
+    DeductResult outcome;
+};
+
+// Serve stockInventory to terminals on 'port' until the process is stopped
+bool ServeInventory(uint16_t port);
+
+// This terminal's connection to an inventory server
+class InventoryClient
+{
+public:
+    ~InventoryClient() { Disconnect(); }
+
+    // Connect to "host:port" and read the server's stock into 'quantities',
+    // as ReadStockFile would, for ApplyStockFile(). Deductions left Unknown
+    // on an earlier connection are settled with the server here.
+    bool Connect(const std::string &address, std::vector<std::pair<PartId, int>> &quantities);
+
+    // Connect again to the last address after the connection dropped; the
+    // client stays Active if this fails
+    bool Reconnect(std::vector<std::pair<PartId, int>> &quantities);
+
+    // Apply pushed quantities from now on (call once the snapshot is
+    // applied). The callbacks run on the receiving thread: 'onChange' with
+    // the parts whose mirrored quantity changed, 'onLost' if the connection
+    // drops, 'onSettled' once the outcome of an Unknown deduction is known
+    // (those settled by Connect first).
+    void Start(std::function<void(std::vector<PartId>)> onChange, std::function<void()> onLost,
+               std::function<void(StockSettlement)> onSettled);
+    void Disconnect();
+
+    // True from a successful Connect() until Disconnect(), even if the
+    // connection dropped: the mirror is never deducted from locally
+    bool Active() const { return m_active; }
+    bool Connected() const { return m_connected; }
+
+    // Reserve 'demands' on the server, then commit them. The mirror holds
+    // the new quantities when this returns. If the commit went unanswered
+    // the result is Unknown and its request id goes to 'unsettled'.
+    DeductResult Deduct(Span<PartDemand> demands, std::vector<PartId> *shortParts = nullptr,
+                        uint32_t *unsettled = nullptr);
+
+private:
+    // A request waiting for its Result
+    struct Pending {
+        bool                  done = false;
+        StockStatus           status = StockStatus::Invalid;
+        std::vector<PartId>   parts; // the parts in the Result
+    };
+
+    intptr_t                                 m_socket = -1;
+    std::atomic<bool>                        m_active{false};
+    std::atomic<bool>                        m_connected{false};
+    std::atomic<bool>                        m_stopping{false}; // receiver stopped on purpose
+    std::thread                              m_receiver;
+    std::string                              m_address;
+    uint64_t                                 m_terminal = 0; // random, once per process
+    std::string                              m_received;   // unparsed bytes
+    std::vector<PartId>                      m_localPart;  // server part id -> PartId
+    std::vector<uint32_t>                    m_serverPart; // PartId -> server part id
+    std::function<void(std::vector<PartId>)> m_onChange;
+    std::function<void()>                    m_onLost;
+    std::function<void(StockSettlement)>     m_onSettled;
+
+    // Held by Deduct and while connecting, so neither sees the socket or the
+    // part maps change under it
+    std::mutex                               m_connectMutex;
+    std::mutex                               m_sendMutex;
+    std::mutex                               m_mutex; // guards the fields below
+    std::condition_variable                  m_resultReady;
+    uint32_t                                 m_nextRequest = 0;
+    std::unordered_map<uint32_t, Pending*>   m_pending;
+    std::vector<uint32_t>                    m_unsettled; // commits sent but not answered
+    std::vector<StockSettlement>             m_settled;   // by Connect, for Start to report
+
+    bool Send(const std::string &frame);
+    bool Request(StockFrame type, uint32_t request, Span<PartDemand> demands, Pending *pending);
+    bool Settle(std::vector<std::pair<PartId, int>> &quantities);
+    bool ReadFrame(uint8_t &type, std::string &body);
+    void Receive();
+    void Shutdown();
+    void Close();
+};
+
+extern InventoryClient g_inventoryClient;
+
+// --------------------------- Stock Ledger ---------------------------
+// Crash-safe record of the live stock, so deductions survive a restart.
+// Changes are appended to a write-ahead log (stock.txt.wal): per completed
+// card its (part, delta) pairs under the report id. Once the log is long the
+// writer thread compacts it into a snapshot (stock.txt.snap) of every
+// quantity and the stock.txt baseline, and starts a new log; startup loads
+// the snapshot and replays the short tail. stock.txt edits are merged into
+// the restored stock as restocks, as the hot reload does. Callers only
+// queue records; the log is written and synced in groups.
+
+// Stock as read at startup (on any thread)
+struct LoadedStock {
+    bool                                restored = false; // the ledger had a snapshot
+    std::vector<std::pair<PartId, int>> live;     // the ledger's quantities, by PartId
+    std::vector<std::pair<PartId, int>> baseline; // stock.txt as last merged into them
+    bool                                fileRead = false;
+    std::vector<std::pair<PartId, int>> file;     // stock.txt now
+};
+
+class StockLedger
+{
+public:
+    ~StockLedger() { Stop(); }
+
+    // Open or create the log and snapshot, recovering from a crash, and read
+    // the stock they hold into 'stock'
+    bool Open(const std::string &logFile, const std::string &snapshotFile, LoadedStock &stock);
+    bool IsOpen() const { return m_open; }
+
+    // Start the writer thread; changes recorded before are written first
+    void Start(int syncIntervalMs);
+
+    // Write everything queued and compact it into a snapshot, then close
+    void Stop();
+
+    // Queue a change; ignored while the ledger is not open
+    void RecordDeduction(Span<PartDemand> parts, uint32_t reportId);
+    void RecordRestock(std::vector<std::pair<PartId, int>> deltas,
+                       std::vector<std::pair<PartId, int>> file);
+    void RecordReset(std::vector<std::pair<PartId, int>> file);
+
+private:
+    struct Change {
+        enum Kind { Deduction, Restock, Reset } kind;
+        uint32_t                            reportId;
+        size_t                              firstDelta; // in the queued deltas
+        size_t                              deltaCount;
+        std::vector<std::pair<PartId, int>> file;       // new stock.txt baseline
+    };
+
+    bool                                 m_open = false;
+    std::string                          m_logFile;
+    std::string                          m_snapshotFile;
+
+    // Writer thread state (set up by Open)
+    FILE                                *m_log = nullptr;
+    uint64_t                             m_generation = 0; // of the snapshot the log follows
+    size_t                               m_logRecords = 0;
+    std::vector<uint32_t>                m_logNames;       // by PartId: name id in the log
+    uint32_t                             m_logNameCount = 0;
+    std::vector<int>                     m_live;           // by PartId
+    std::vector<std::pair<PartId, int>>  m_file;
+    std::string                          m_pending;        // log bytes not written yet
+    std::string                          m_payload;
+    std::chrono::milliseconds            m_syncInterval{1000};
+
+    std::atomic<bool>                    m_running{false};
+    std::thread                          m_thread;
+    std::mutex                           m_mutex; // guards the queue
+    std::condition_variable              m_wake;
+    std::vector<Change>                  m_queue;
+    std::vector<std::pair<PartId, int>>  m_queuedDeltas;
+
+    void AddLive(PartId part, int delta)
+    {
+        if (part >= m_live.size()) m_live.resize(part + 1, 0);
+        m_live[part] += delta;
+    }
+
+    void Queue(Change change, const std::pair<PartId, int> *deltas, size_t count);
+    void Run();
+    void Apply(Change &change, const std::vector<std::pair<PartId, int>> &deltas);
+    void AppendDeduction(const Change &change, const std::vector<std::pair<PartId, int>> &deltas);
+    uint32_t LogName(PartId part);
+    bool Compact();
+    bool WriteSnapshot();
+    bool StartLog();
+    void WriteLog(bool sync);
+};
+
+extern StockLedger g_stockLedger;
+
+// Read the ledger next to 'stockFile' (stockFile.wal, stockFile.snap) and
+// 'stockFile' itself; touches no live stock
+void ReadStock(const std::string &stockFile, LoadedStock &stock);
+
+// Make 'stock' the live stock: the ledger's quantities with stock.txt merged
+// in, or stock.txt alone the first time. Starts the ledger. Returns false if
+// there was neither.
+bool ApplyStock(LoadedStock &&stock);
+
+// --------------------------- Work Orders ---------------------------
+// Completing task cards: part deduction and reporting, shared by the GUI's
+// task steps and batch import and by the headless engine.
+
+// One completed task card reported from the line: aircraft|system|task
+struct WorkOrder {
+    std::string aircraft;
+    std::string system;
+    std::string task;
+};
+
+// Parse one "aircraft|system|task" line; false if a field is missing
+bool ParseWorkOrder(std::string_view line, WorkOrder &order);
+
+// Read a work-order file, one "aircraft|system|task" line per completed card
+bool LoadWorkOrdersFromFile(const std::string &filename, std::vector<WorkOrder> &orders);
+
+// Deduct 'demands' all or nothing: on the inventory server when this
+// terminal is connected to one, else from stockInventory. On a shortage the
+// short parts are appended to 'shortParts' (if given); when the server left
+// the outcome Unknown its request id goes to 'unsettled' (if given).
+DeductResult DeductStock(Span<PartDemand> demands, std::vector<PartId> *shortParts = nullptr,
+                         uint32_t *unsettled = nullptr);
+
+// Deduct the parts of one task: all of them, or none if any is short or the
+// inventory server is unreachable. Returns true only if they were deducted.
+bool CheckAndDeductParts(Span<PartDemand> parts);
+
+// Report ids come in blocks reserved in a persisted high-water mark
+// (maintenance_reports.id). The mark is written once per block, before any of
+// its ids is used, so no id is handed out twice even after a crash. Stop()
+// writes back the first unused id, so only a crash skips the rest of the
+// last block. Blocks grow while they run out fast (batch imports) and shrink
+// back otherwise. Inside a block an atomic counter gives out the ids, so any
+// thread may allocate without a lock.
+class ReportIdAllocator
+{
+public:
+    // Continue after the persisted mark and after 'lastUsed' (the journal's
+    // highest id). Call before any Next(); without Open() ids start at 1001
+    // and nothing is persisted.
+    bool Open(const std::string &filename, uint32_t lastUsed);
+
+    // Persist the first unused id as the mark (at exit). A Next() after
+    // this reserves a new block first.
+    void Stop();
+
+    // The fast path's increment and check are sequentially consistent with
+    // Stop(), which lowers the limit before it reads the counter
+    uint32_t Next()
+    {
+        uint32_t id = m_next.fetch_add(1);
+        if (id < m_limit.load()) return id;
+        return NextBlock(id);
+    }
+
+private:
+    std::atomic<uint32_t>                 m_next{1001};
+    std::atomic<uint32_t>                 m_limit{1001}; // end of the reserved block
+    std::mutex                            m_blockMutex;
+    std::string                           m_filename;
+    uint32_t                              m_mark = 0;    // as last written
+    uint32_t                              m_blockSize = 0;
+    std::chrono::steady_clock::time_point m_lastBlock;
+
+    uint32_t NextBlock(uint32_t id);
+};
+
+extern ReportIdAllocator g_reportIds;
+
+// Number of the next report ("RPT-<id>"), from g_reportIds; any thread
+uint32_t NextReportId();
+
+// Add the report of one completed task to 'out' (its text and journal
+// record), log its parts to the stock ledger and return its summary
+ReportRecord FormatReport(uint32_t reportId, uint32_t date, const std::string &aircraft,
+                          const std::string &system, const Task &task, ReportBatch &out);
+
+// Report one completed task under the next report id and today's date and
+// queue it for g_reportWriter. 'textOffset' receives the offset of its text
+// in the report file.
+ReportRecord AppendReport(const std::string &aircraft, const std::string &system,
+                          const Task &task, uint64_t *textOffset = nullptr);
+
+// Resolves work orders to tasks of one catalog snapshot. A system's task
+// names are indexed the first time an order names that system.
+class WorkOrderResolver
+{
+public:
+    explicit WorkOrderResolver(std::shared_ptr<const TaskCatalog> catalog)
+        : m_catalog(std::move(catalog)) {}
+
+    const std::shared_ptr<const TaskCatalog>& Catalog() const { return m_catalog; }
+
+    // The order's task, or an empty handle and the reason in 'error'
+    TaskHandle Resolve(const WorkOrder &order, std::string &error);
+
+private:
+    std::shared_ptr<const TaskCatalog>                                  m_catalog;
+    std::map<std::string, std::unordered_map<std::string_view, size_t>> m_names; // per system
+};
+
+// A resolved card, held with the catalog snapshot it was checked against
+struct CompletedCard {
+    std::string aircraft;
+    std::string system;
+    TaskHandle  task;
+};
+
+// Outcome of CompleteBatch
+struct BatchResult {
+    size_t              completed = 0;
+    std::string         error;        // skipped cards, or the shortage that stopped the batch
+    std::vector<PartId> changedParts; // parts whose stock was deducted
+    std::vector<std::pair<ReportRecord, uint64_t>> reports; // summary and text offset, in file order
+    // When the stock server left the deduction Unknown: its request, and the
+    // cards to report should it settle as Done
+    uint32_t                   unsettled = 0;
+    std::vector<CompletedCard> held;
+};
+
+// Complete many task cards in one pass: stock for the whole batch is
+// reserved at once (all or nothing) and every report goes to the writer as a
+// single block
+BatchResult CompleteBatch(const std::vector<WorkOrder> &orders);
+
+// Report cards whose parts are already deducted (held by a deduction that
+// settled as Done), as CompleteBatch does
+BatchResult ReportCards(const std::vector<CompletedCard> &cards);
+
+// Complete one card on its own: resolve it, deduct its parts and add its
+// report to 'batch', which the caller submits. Returns the report id, or 0
+// and the reason in 'error'.
+uint32_t CompleteWorkOrder(WorkOrderResolver &resolver, const WorkOrder &order, uint32_t date,
+                           ReportBatch &batch, std::string &error);
+
+// --------------------------- Work Package ---------------------------
+// Task cards planned across aircraft, with their summed part demand checked
+// against the live stock before any work starts. Demand is kept per part and
+// updated from the task's own part list as cards are added or removed, and
+// only the parts whose stock changed are re-checked, so the forecast never
+// rescans the package. Cards hold their catalog snapshot, so a reload does
+// not change what was planned.
+
+struct PlannedTask {
+    std::string aircraft;
+    std::string system;
+    TaskHandle  task;
+};
+
+class WorkPackage
+{
+public:
+    static const size_t npos = static_cast<size_t>(-1);
+
+    void Add(std::string aircraft, std::string system, TaskHandle task);
+    // Cards after 'index' move up by one
+    void Remove(size_t index);
+    void Clear();
+
+    size_t Size() const { return m_tasks.size(); }
+    const PlannedTask& operator[](size_t index) const { return m_tasks[index]; }
+    // First card of that aircraft, system and task name, or npos
+    size_t Find(const std::string &aircraft, const std::string &system, std::string_view task) const;
+
+    // Parts the package needs, in the order they were first needed
+    const std::vector<PartId>& Parts() const { return m_parts; }
+    int Demand(PartId part) const { return part < m_demand.size() ? m_demand[part] : 0; }
+    // Units of 'part' the stock is missing for the whole package, 0 if covered
+    int Shortfall(PartId part) const { return std::max(0, Demand(part) - stockInventory.Quantity(part)); }
+    bool IsShort(PartId part) const { return part < m_short.size() && m_short[part]; }
+    // Parts of Parts() the stock cannot cover
+    size_t ShortCount() const { return m_shortCount; }
+
+    // The stock of 'changed' moved (deductions, restocks, other terminals)
+    void RecheckStock(const std::vector<PartId> &changed);
+    // Every part may have changed (the stocked part set was rebuilt)
+    void RecheckStock();
+
+private:
+    std::vector<PlannedTask> m_tasks;
+    std::vector<PartId>      m_parts; // parts with demand > 0
+    std::vector<size_t>      m_slot;  // by part: position in m_parts
+    std::vector<int>         m_demand;
+    std::vector<char>        m_short;
+    size_t                   m_shortCount = 0;
+
+    void AddDemand(Span<PartDemand> parts, int sign);
+    void Recheck(PartId part);
+};
+
+// The demands the live stock cannot cover right now, with the units missing
+std::vector<PartDemand> StockShortfall(Span<PartDemand> demands);
+
+#endif // MRO_CORE_H
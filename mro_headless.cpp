@@ -0,0 +1,337 @@
+// Headless MRO engine: completes task cards without the GUI, for planning
+// servers and MES/ERP feeds.
+//
+//   mro_headless [--tasks tasks.txt] [--stock stock.txt | --stock-server HOST:PORT] [--listen PORT]
+//                [--metrics-log SECONDS]
+//   mro_headless --serve-stock PORT [--stock stock.txt]
+//   mro_headless --compile-catalog [tasks.txt]
+//   mro_headless --export-reports FILE [--format text|csv|jsonl]
+//
+// Work orders are "aircraft|system|task" lines read from stdin or, with
+// --listen, from each client connecting to the TCP port (one client at a
+// time). Every order gets one reply line, in order:
+//   OK RPT-1001
+//   ERROR Unknown task: Hydraulic / Replace Pump
+// Each card is completed on its own (its parts all or nothing). Reports go to
+// the same files as the GUI's; a read's replies are sent once its reports
+// have been handed to the OS. With --stock-server parts are deducted from a
+// shared inventory server, which --serve-stock runs over stock.txt; a lost
+// connection is retried, and an order whose deduction the server did not
+// confirm fails naming its stock request, whose outcome is logged once known.
+// --export-reports writes every report of the journal to FILE.
+// --metrics-log appends hot-path latencies to mro_metrics.log every SECONDS.
+
+#include "mro_core.h"
+#include "mro_net.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+// --------------------------- Stock Server ---------------------------
+
+// An order whose deduction went unconfirmed was answered with an error
+// naming its request; the settled outcome is logged under that number
+static void LogSettlement(StockSettlement settled)
+{
+    std::string request = "stock request " + std::to_string(settled.request);
+    switch (settled.outcome) {
+    case DeductResult::Done:
+        LogWarning("The stock server deducted " + request + "; its work order has no report");
+        break;
+    case DeductResult::Offline:
+        LogWarning("The stock server did not deduct " + request);
+        break;
+    default:
+        LogWarning("The stock server could not tell whether it deducted " + request);
+        break;
+    }
+}
+
+// Connect again after the stock server went away, at most every
+// kStockReconnectMs; orders fail as unreachable meanwhile
+static void ReconnectStockServer()
+{
+    static std::chrono::steady_clock::time_point lastAttempt;
+    if (!g_inventoryClient.Active() || g_inventoryClient.Connected()) return;
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastAttempt < std::chrono::milliseconds(kStockReconnectMs)) return;
+    lastAttempt = now;
+    std::vector<std::pair<PartId, int>> quantities;
+    if (!g_inventoryClient.Reconnect(quantities)) return;
+    ApplyStockFile(std::move(quantities));
+    g_inventoryClient.Start(nullptr, nullptr, LogSettlement);
+}
+
+// --------------------------- Order Stream ---------------------------
+// Work orders of one input, processed a read at a time: the complete lines
+// of a read are completed, their reports submitted as one batch and their
+// replies written together.
+
+struct OrderStats {
+    size_t orders = 0;
+    size_t completed = 0;
+};
+
+class OrderStream
+{
+public:
+    // 'reply' writes reply bytes to the client; false ends the stream
+    OrderStream(WorkOrderResolver &resolver, OrderStats &stats,
+                std::function<bool(std::string_view)> reply)
+        : m_resolver(resolver), m_stats(stats), m_reply(std::move(reply)) {}
+
+    // Bytes read from the input. Returns false if the client went away.
+    bool Feed(std::string_view bytes)
+    {
+        size_t last = bytes.rfind('\n');
+        if (last == std::string_view::npos) {
+            m_pending.append(bytes);
+            return true;
+        }
+        bool ok;
+        if (m_pending.empty()) {
+            ok = Process(bytes.substr(0, last + 1));
+        } else {
+            m_pending.append(bytes.substr(0, last + 1));
+            ok = Process(m_pending);
+            m_pending.clear();
+        }
+        m_pending.append(bytes.substr(last + 1));
+        return ok;
+    }
+
+    // End of input: a last line without a newline is still an order
+    bool Finish()
+    {
+        if (m_pending.empty()) return true;
+        std::string rest = std::move(m_pending);
+        m_pending.clear();
+        return Process(rest);
+    }
+
+private:
+    WorkOrderResolver                    &m_resolver;
+    OrderStats                           &m_stats;
+    std::function<bool(std::string_view)> m_reply;
+    std::string                           m_pending; // unfinished last line
+    std::string                           m_replies;
+    WorkOrder                             m_order;
+    std::string                           m_error;
+
+    bool Process(std::string_view data)
+    {
+        ReconnectStockServer();
+        uint32_t date = g_clock.Today();
+        ReportBatch batch;
+        size_t pos = 0;
+        while (pos < data.size()) {
+            size_t eol = data.find('\n', pos);
+            if (eol == std::string_view::npos) eol = data.size();
+            std::string_view line = data.substr(pos, eol - pos);
+            pos = eol + 1;
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (line.empty()) continue;
+
+            m_stats.orders++;
+            if (!ParseWorkOrder(line, m_order)) {
+                m_replies += "ERROR Invalid work order format\n";
+                continue;
+            }
+            uint32_t id = CompleteWorkOrder(m_resolver, m_order, date, batch, m_error);
+            if (id == 0) {
+                m_replies += "ERROR " + m_error + "\n";
+                continue;
+            }
+            m_stats.completed++;
+            m_replies += "OK " + ReportIdText(id) + "\n";
+        }
+        if (!batch.text.empty()) {
+            g_reportWriter.Submit(std::move(batch));
+            g_reportWriter.Flush();
+        }
+        bool ok = m_replies.empty() || m_reply(m_replies);
+        m_replies.clear();
+        return ok;
+    }
+};
+
+static const size_t kReadBufferBytes = 64 << 10;
+
+static void ProcessStdin(WorkOrderResolver &resolver, OrderStats &stats)
+{
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    OrderStream stream(resolver, stats, [](std::string_view replies) {
+        fwrite(replies.data(), 1, replies.size(), stdout);
+        return fflush(stdout) == 0;
+    });
+    std::vector<char> buffer(kReadBufferBytes);
+    size_t n;
+    while ((n = fread(buffer.data(), 1, buffer.size(), stdin)) > 0) {
+        if (!stream.Feed(std::string_view(buffer.data(), n))) return;
+    }
+    stream.Finish();
+}
+
+// Serve clients one after another until the process is stopped
+static bool ServeOrders(uint16_t port, WorkOrderResolver &resolver, OrderStats &stats)
+{
+    Socket server = ListenTcp(port, 8);
+    if (server == INVALID_SOCKET) return false;
+    fprintf(stderr, "Listening on port %u\n", static_cast<unsigned>(port));
+
+    std::vector<char> buffer(kReadBufferBytes);
+    for (;;) {
+        Socket client = accept(server, nullptr, nullptr);
+        if (client == INVALID_SOCKET) continue;
+        OrderStream stream(resolver, stats, [client](std::string_view replies) {
+            return SendAll(client, replies);
+        });
+        bool ok = true;
+        int n;
+        while (ok && (n = recv(client, buffer.data(), static_cast<int>(buffer.size()), 0)) > 0) {
+            ok = stream.Feed(std::string_view(buffer.data(), static_cast<size_t>(n)));
+        }
+        if (ok) stream.Finish();
+        CloseSocket(client);
+    }
+}
+
+// --------------------------- Main ---------------------------
+
+static int Usage()
+{
+    fprintf(stderr,
+            "usage: mro_headless [--tasks FILE] [--stock FILE | --stock-server HOST:PORT] [--listen PORT]\n"
+            "                    [--metrics-log SECONDS]\n"
+            "       mro_headless --serve-stock PORT [--stock FILE]\n"
+            "       mro_headless --compile-catalog [FILE]\n"
+            "       mro_headless --export-reports FILE [--format text|csv|jsonl]\n");
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    std::string tasksFile = "tasks.txt";
+    std::string stockFile = "stock.txt";
+    std::string stockServer;
+    std::string exportFile;
+    ReportFormat exportFormat = ReportFormat::Text;
+    int port = 0;
+    int stockPort = 0;
+    int metricsInterval = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--compile-catalog") {
+            return CompileCatalog(i + 1 < argc ? argv[i + 1] : "tasks.txt") ? 0 : 1;
+        } else if (arg == "--tasks" && i + 1 < argc) {
+            tasksFile = argv[++i];
+        } else if (arg == "--stock" && i + 1 < argc) {
+            stockFile = argv[++i];
+        } else if (arg == "--stock-server" && i + 1 < argc) {
+            stockServer = argv[++i];
+        } else if (arg == "--listen" && i + 1 < argc) {
+            port = atoi(argv[++i]);
+            if (port <= 0 || port > 65535) return Usage();
+        } else if (arg == "--export-reports" && i + 1 < argc) {
+            exportFile = argv[++i];
+        } else if (arg == "--format" && i + 1 < argc) {
+            if (!ParseReportFormat(argv[++i], exportFormat)) return Usage();
+        } else if (arg == "--metrics-log" && i + 1 < argc) {
+            metricsInterval = atoi(argv[++i]);
+            if (metricsInterval <= 0) return Usage();
+        } else if (arg == "--serve-stock" && i + 1 < argc) {
+            stockPort = atoi(argv[++i]);
+            if (stockPort <= 0 || stockPort > 65535) return Usage();
+        } else {
+            return Usage();
+        }
+    }
+
+    // Inventory server: only the stock is needed
+    if (stockPort) {
+        if (!LoadStockFromFile(stockFile)) {
+            LogWarning("Could not load stock from " + stockFile + ". Proceeding with empty stock!");
+        }
+        fprintf(stderr, "Serving %zu stocked parts on port %d\n", stockParts.size(), stockPort);
+        return ServeInventory(static_cast<uint16_t>(stockPort)) ? 0 : 1;
+    }
+
+    // Report export: only the journal is needed
+    if (!exportFile.empty()) {
+        if (!g_reportJournal.Open("maintenance_reports.jrn", "maintenance_reports.jrn.idx")) {
+            fprintf(stderr, "Could not open the report journal maintenance_reports.jrn\n");
+            return 1;
+        }
+        auto start = std::chrono::steady_clock::now();
+        std::vector<uint32_t> all = g_reportJournal.Query(0, std::numeric_limits<uint32_t>::max(), "", "");
+        size_t unreadable = 0;
+        if (!ExportReports(g_reportJournal, all, exportFormat, exportFile, unreadable)) {
+            fprintf(stderr, "Could not write %s\n", exportFile.c_str());
+            return 1;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        fprintf(stderr, "%zu reports exported in %.3f s (%zu unreadable)\n",
+                all.size() - unreadable, seconds, unreadable);
+        return unreadable ? 1 : 0;
+    }
+
+    if (metricsInterval) StartMetricsDump("mro_metrics.log", metricsInterval);
+    std::shared_ptr<const TaskCatalog> catalog = ReadCatalog(tasksFile);
+    if (!catalog) {
+        fprintf(stderr, "Could not load tasks from %s\n", tasksFile.c_str());
+        return 1;
+    }
+    PublishCatalog(catalog);
+    if (!stockServer.empty()) {
+        std::vector<std::pair<PartId, int>> quantities;
+        if (!g_inventoryClient.Connect(stockServer, quantities)) return 1;
+        ApplyStockFile(std::move(quantities));
+        g_inventoryClient.Start(nullptr, nullptr, LogSettlement);
+    } else if (!LoadStockFromFile(stockFile)) {
+        LogWarning("Could not load stock from " + stockFile + ". Proceeding with empty stock!");
+    }
+
+    std::string journalFile, indexFile;
+    if (g_reportJournal.Open("maintenance_reports.jrn", "maintenance_reports.jrn.idx")) {
+        journalFile = g_reportJournal.JournalFile();
+        indexFile = g_reportJournal.IndexFile();
+    } else {
+        LogWarning("Could not open the report journal maintenance_reports.jrn");
+    }
+    // Report numbers continue where the last session (or the journal) ended
+    g_reportIds.Open("maintenance_reports.id", g_reportJournal.LastReportId());
+    if (!g_reportWriter.Start("maintenance_reports.txt", journalFile, indexFile, kReportSyncIntervalMs)) {
+        LogWarning("Could not open maintenance_reports.txt; reports will be written synchronously");
+    }
+    fprintf(stderr, "%zu tasks, %zu stocked parts\n", catalog->TaskCount(), stockParts.size());
+
+    WorkOrderResolver resolver(catalog);
+    OrderStats stats;
+    auto start = std::chrono::steady_clock::now();
+    bool ok = true;
+    if (port) {
+        if (!StartSockets()) {
+            LogError("Could not start networking");
+            return 1;
+        }
+        ok = ServeOrders(static_cast<uint16_t>(port), resolver, stats);
+    } else {
+        ProcessStdin(resolver, stats);
+    }
+
+    // Make sure every queued report reaches the disk
+    g_reportWriter.Stop();
+    g_reportIds.Stop();
+    g_stockLedger.Stop();
+    g_inventoryClient.Disconnect();
+    StopMetricsDump();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "%zu work orders, %zu completed in %.3f s (%.0f orders/s)\n",
+            stats.orders, stats.completed, seconds, seconds > 0 ? stats.orders / seconds : 0.0);
+    return ok ? 0 : 1;
+}
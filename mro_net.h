@@ -0,0 +1,49 @@
+// TCP sockets shared by the core's inventory service and the headless order
+// listener. Kept out of mro_core.h so the GUI and other users of the core do
+// not pull in the platform's socket and Windows headers.
+
+#ifndef MRO_NET_H
+#define MRO_NET_H
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h> // before any <windows.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include <cstdint>
+#include <string_view>
+
+#ifdef _WIN32
+using Socket = SOCKET;
+#else
+using Socket = int;
+static const Socket INVALID_SOCKET = -1;
+#endif
+
+void CloseSocket(Socket s);
+
+// Socket library setup (WSAStartup; SIGPIPE ignored elsewhere), once per
+// process; false if networking is unavailable
+bool StartSockets();
+
+// Blocking send of the whole buffer
+bool SendAll(Socket s, std::string_view bytes);
+
+// A socket listening on 'port' on every interface, or INVALID_SOCKET
+// (logged) if it could not be set up
+Socket ListenTcp(uint16_t port, int backlog);
+
+#endif // MRO_NET_H
@@ -1,146 +1,348 @@
 #include <wx/wx.h>
-#include <wx/listbox.h>
-#include <fstream>
-#include <sstream>
-#include <string>
-#include <vector>
-#include <map>
-#include <ctime>
-#include <limits>
-
-// --------------------------- Data Structures ---------------------------
-
-// Representation of a Task with steps and required parts
-struct Task {
-    std::string name;
-    std::vector<std::string> steps;
-    std::vector<std::string> requiredParts;
-};
+#include <wx/listctrl.h>
+#include <wx/filedlg.h>
+#include <wx/vlbox.h>
+#include <wx/renderer.h>
+#include <wx/settings.h>
+#include <wx/fswatcher.h>
+#include <wx/filename.h>
+#include <wx/timer.h>
+#include <wx/srchctrl.h>
+
+#include "mro_core.h"
 
-// Global map: System -> vector of Task
-static std::map<std::string, std::vector<Task>> systemTasks;
+// --------------------------- Globals ---------------------------
 
-// Global stock map: part -> quantity
-static std::map<std::string, int> stockInventory; 
-// NOT initialized in code now; will be loaded from "stock.txt"
+// Used when there is no fleet file
+static const char *const kDefaultAircraftTypes[] = {"Boeing 737", "Airbus A320", "Gulfstream G550"};
 
-// Global string to store user-chosen aircraft type
+// Global string to store user-chosen aircraft (label of an Aircraft)
 static std::string g_chosenAircraft = "";
+// Its type; the task lists only show cards that apply to it
+static std::string g_chosenAircraftType = "";
+
+// --------------------------- ReportLogCtrl ---------------------------
+// "Maintenance Report Log" view: one row per report of this session.
+// The newest kReportLogCapacity reports are held in a fixed ring buffer;
+// rows older than that are paged back in from the report file (using the
+// byte offset recorded for each report) when they are scrolled into view.
+// Memory and append cost therefore stay flat for the whole session.
+
+// Recover the summary fields from the text written by AppendReport
+static ReportRecord ParseReportText(std::string_view text)
+{
+    ReportRecord rec;
+    auto field = [](std::string_view line, std::string_view key, std::string &out) {
+        if (line.substr(0, key.size()) != key) return false;
+        out.assign(line.substr(key.size()));
+        return true;
+    };
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        if (eol == std::string_view::npos) eol = text.size();
+        std::string_view line = text.substr(pos, eol - pos);
+        pos = eol + 1;
+        if (field(line, "Report ID: ", rec.id) || field(line, "Date: ", rec.date) ||
+            field(line, "Aircraft: ", rec.aircraft) || field(line, "System: ", rec.system) ||
+            field(line, "Completed Task: ", rec.task)) {
+            continue;
+        }
+        if (line.substr(0, 4) == "  - ") {
+            if (!rec.parts.empty()) rec.parts += ", ";
+            rec.parts.append(line.substr(4));
+        }
+    }
+    return rec;
+}
 
-// --------------------------- Helper Functions ---------------------------
+// Columns shared by the report log and the journal query results
+static void InsertReportColumns(wxListCtrl *list)
+{
+    list->InsertColumn(0, "Report ID", wxLIST_FORMAT_LEFT, 80);
+    list->InsertColumn(1, "Date", wxLIST_FORMAT_LEFT, 80);
+    list->InsertColumn(2, "Aircraft", wxLIST_FORMAT_LEFT, 110);
+    list->InsertColumn(3, "System", wxLIST_FORMAT_LEFT, 90);
+    list->InsertColumn(4, "Completed Task", wxLIST_FORMAT_LEFT, 180);
+    list->InsertColumn(5, "Used Parts", wxLIST_FORMAT_LEFT, 250);
+}
 
-// 1) Load tasks from a text file
-bool LoadTasksFromFile(const std::string &filename) 
+static wxString ReportColumnText(const ReportRecord &rec, long column)
 {
-    std::ifstream ifs(filename);
-    if (!ifs.is_open()) {
-        wxLogError("Failed to open tasks file: %s", filename);
-        return false;
+    switch (column) {
+        case 0:  return rec.id;
+        case 1:  return rec.date;
+        case 2:  return rec.aircraft;
+        case 3:  return rec.system;
+        case 4:  return rec.task;
+        default: return rec.parts;
     }
-    // Format per line: SystemName|TaskName|step1,step2,step3...|part1,part2,part3...
-    std::string line;
-    while (std::getline(ifs, line)) {
-        if (line.empty()) continue;
-        std::stringstream ss(line);
-        std::vector<std::string> tokens;
-        std::string temp;
-        while (std::getline(ss, temp, '|')) {
-            tokens.push_back(temp);
-        }
-        if (tokens.size() < 4) {
-            wxLogWarning("Invalid task format: %s", line);
-            continue;
-        }
+}
 
-        std::string sysName   = tokens[0];
-        std::string taskName  = tokens[1];
-        std::string stepsCSV  = tokens[2];
-        std::string partsCSV  = tokens[3];
+static const size_t kReportLogCapacity = 256;  // reports kept in memory
+static const size_t kReportLogPageSize = 32;   // reports per page, to start with
+static const size_t kReportLogMaxPages = 4096; // page offsets kept
 
-        // Convert stepsCSV into a vector
-        std::vector<std::string> steps;
-        {
-            std::stringstream ssteps(stepsCSV);
-            while (std::getline(ssteps, temp, ',')) {
-                if (!temp.empty()) steps.push_back(temp);
-            }
+class ReportLogCtrl : public wxListCtrl
+{
+public:
+    ReportLogCtrl(wxWindow *parent, const std::string &reportFile)
+        : wxListCtrl(parent, wxID_ANY, wxDefaultPosition, wxSize(400, 150),
+                     wxLC_REPORT | wxLC_VIRTUAL | wxLC_SINGLE_SEL),
+          m_reportFile(reportFile),
+          m_ring(kReportLogCapacity)
+    {
+        InsertReportColumns(this);
+    }
+
+    // Add a report that was just submitted to the report file.
+    // textOffset is where its text starts in the file.
+    void Add(ReportRecord rec, uint64_t textOffset)
+    {
+        Push(std::move(rec), textOffset);
+        ShowNewest();
+    }
+
+    // Add reports that were submitted together, in file order, updating the
+    // control only once
+    void AddBatch(std::vector<std::pair<ReportRecord, uint64_t>> &&reports)
+    {
+        for (auto &r : reports) {
+            Push(std::move(r.first), r.second);
         }
+        ShowNewest();
+    }
 
-        // Convert partsCSV into a vector
-        std::vector<std::string> parts;
-        {
-            std::stringstream sparts(partsCSV);
-            while (std::getline(sparts, temp, ',')) {
-                if (!temp.empty()) parts.push_back(temp);
+private:
+    std::string               m_reportFile;
+    std::vector<ReportRecord> m_ring;        // newest reports, slot = index % capacity
+    size_t                    m_count = 0;
+
+    // File offset of every m_pageSize-th report. When the table is full
+    // every other entry is dropped and the pages double in size, so a
+    // session of any length keeps at most kReportLogMaxPages offsets.
+    std::vector<uint64_t>     m_pageOffsets;
+    size_t                    m_pageSize = kReportLogPageSize;
+    uint64_t                  m_newestOffset = 0;
+
+    // Most recently paged-in run of older reports
+    mutable size_t                    m_pageFirst = 0;
+    mutable std::vector<ReportRecord> m_page;
+
+    void Push(ReportRecord &&rec, uint64_t textOffset)
+    {
+        m_ring[m_count % m_ring.size()] = std::move(rec);
+        if (m_count % m_pageSize == 0) {
+            if (m_pageOffsets.size() == kReportLogMaxPages) {
+                for (size_t i = 0; i < m_pageOffsets.size() / 2; i++) m_pageOffsets[i] = m_pageOffsets[2 * i];
+                m_pageOffsets.resize(m_pageOffsets.size() / 2);
+                m_pageSize *= 2;
+                m_page.clear();
             }
+            if (m_count % m_pageSize == 0) m_pageOffsets.push_back(textOffset);
         }
+        m_newestOffset = textOffset;
+        m_count++;
+    }
 
-        Task t{taskName, steps, parts};
-        systemTasks[sysName].push_back(t);
+    void ShowNewest()
+    {
+        SetItemCount(static_cast<long>(m_count));
+        if (m_count > 0) EnsureVisible(static_cast<long>(m_count - 1));
     }
-    ifs.close();
-    return true;
-}
 
-// 2) Load stock from a text file (part|quantity)
-bool LoadStockFromFile(const std::string &filename)
-{
-    std::ifstream ifs(filename);
-    if (!ifs.is_open()) {
-        wxLogError("Failed to open stock file: %s", filename);
-        return false;
+    bool InRing(size_t index) const { return index + m_ring.size() >= m_count; }
+
+    const ReportRecord& Record(size_t index) const
+    {
+        if (InRing(index)) return m_ring[index % m_ring.size()];
+        if (index < m_pageFirst || index >= m_pageFirst + m_page.size()) PageIn(index);
+        return m_page[index - m_pageFirst];
     }
-    stockInventory.clear(); // Start fresh
-    std::string line;
-    while (std::getline(ifs, line)) {
-        if (line.empty()) continue;
-        std::stringstream ss(line);
-        std::string partName;
-        std::string qtyStr;
-        if (!std::getline(ss, partName, '|')) {
-            wxLogWarning("Invalid stock format line: %s", line);
-            continue;
-        }
-        if (!std::getline(ss, qtyStr, '|')) {
-            // might not have another '|'
-            wxLogWarning("Invalid stock format line (missing qty): %s", line);
-            continue;
-        }
-        int quantity = 0;
-        try {
-            quantity = std::stoi(qtyStr);
-        } catch(...) {
-            wxLogWarning("Invalid quantity for part: %s in line: %s", qtyStr, line);
-            continue;
+
+    // Read the page of older reports containing 'index' back from the file.
+    // The page ends where the next one starts, or at the newest report, which
+    // always comes later; the reports in it are split at their header lines.
+    void PageIn(size_t index) const
+    {
+        size_t page  = index / m_pageSize;
+        size_t first = page * m_pageSize;
+        size_t last  = std::min(first + m_pageSize, m_count - m_ring.size()); // exclusive
+        uint64_t begin = m_pageOffsets[page];
+        uint64_t end = page + 1 < m_pageOffsets.size() ? m_pageOffsets[page + 1] : m_newestOffset;
+        m_pageFirst = first;
+        m_page.assign(last - first, ReportRecord{});
+
+        std::ifstream ifs(m_reportFile, std::ios::binary);
+        if (!ifs || end < begin) return;
+        std::string bytes(static_cast<size_t>(end - begin), '\0');
+        ifs.seekg(static_cast<std::streamoff>(begin));
+        ifs.read(&bytes[0], static_cast<std::streamsize>(bytes.size()));
+        std::string_view text(bytes.data(), static_cast<size_t>(ifs.gcount()));
+
+        static const std::string_view kNextReport = "\n=== Maintenance Report ===\n";
+        size_t start = 0;
+        for (size_t i = first; i < last && start < text.size(); i++) {
+            size_t next = text.find(kNextReport, start);
+            next = next == std::string_view::npos ? text.size() : next + 1;
+            m_page[i - first] = ParseReportText(text.substr(start, next - start));
+            start = next;
         }
-        stockInventory[partName] = quantity;
     }
-    ifs.close();
-    return true;
-}
 
-// Return current date as a string
-std::string GetCurrentDate() {
-    time_t now = time(nullptr);
-    tm *ltm = localtime(&now);
-    char buffer[30];
-    strftime(buffer, 30, "%Y-%m-%d", ltm);
-    return std::string(buffer);
-}
+    wxString OnGetItemText(long item, long column) const override
+    {
+        if (item < 0 || static_cast<size_t>(item) >= m_count) return wxString();
+        return ReportColumnText(Record(static_cast<size_t>(item)), column);
+    }
+};
 
 // --------------------------- TaskStepsDialog ---------------------------
 // A dialog that shows step-by-step tasks with checkboxes.
 // User must complete each step in order before finishing.
 
+// Fixed-size bitset packed into 64-bit words
+class StepBits
+{
+public:
+    explicit StepBits(size_t size = 0) : m_size(size), m_words((size + 63) / 64, 0) {}
+
+    size_t Size() const { return m_size; }
+    bool Test(size_t i) const { return (m_words[i / 64] >> (i % 64)) & 1u; }
+
+    void Set(size_t i, bool value)
+    {
+        uint64_t bit = uint64_t(1) << (i % 64);
+        if (value) m_words[i / 64] |= bit;
+        else       m_words[i / 64] &= ~bit;
+    }
+
+private:
+    size_t                m_size;
+    std::vector<uint64_t> m_words;
+};
+
+// Virtual checklist of a task's steps. Rows (checkbox + label) are drawn on
+// demand, so no native widget exists per step; the checked state of every
+// step lives in a bitset. Step i+1 becomes checkable once step i has been
+// checked, so the enabled steps are always a prefix and only need a count.
+// Click a row or press Space to toggle it; a toggle is constant time.
+class StepListBox : public wxVListBox
+{
+public:
+    StepListBox(wxWindow *parent, TaskHandle task, std::function<void(size_t)> onToggled)
+        : wxVListBox(parent, wxID_ANY, wxDefaultPosition, wxSize(420, 260), wxBORDER_THEME),
+          m_task(task),
+          m_checked(task->steps.size()),
+          m_onToggled(std::move(onToggled))
+    {
+        // Initially, only the first step is enabled
+        m_enabledCount = std::min<size_t>(1, m_checked.Size());
+        SetItemCount(task->steps.size());
+        Bind(wxEVT_LEFT_DOWN, &StepListBox::OnLeftDown, this);
+        Bind(wxEVT_KEY_DOWN, &StepListBox::OnKeyDown, this);
+    }
+
+    bool IsChecked(size_t step) const { return m_checked.Test(step); }
+    size_t StepCount() const { return m_checked.Size(); }
+    size_t CheckedCount() const { return m_checkedCount; }
+    bool AllChecked() const { return m_checkedCount == m_checked.Size(); }
+
+private:
+    TaskHandle                  m_task;
+    StepBits                    m_checked;
+    size_t                      m_enabledCount = 0;    // steps [0, m_enabledCount) are enabled
+    size_t                      m_checkedCount = 0;
+    size_t                      m_completedPrefix = 0; // leading steps that are all checked
+    std::function<void(size_t)> m_onToggled;
+
+    bool IsEnabled(size_t step) const { return step < m_enabledCount; }
+
+    // 'step' is the row index, the same offset the old per-step window ids
+    // (1000 + i) encoded
+    void Toggle(size_t step)
+    {
+        if (step >= m_checked.Size() || !IsEnabled(step)) return;
+        bool checked = !m_checked.Test(step);
+        m_checked.Set(step, checked);
+        RefreshRow(step);
+        if (checked) {
+            m_checkedCount++;
+            // The prefix only moves past steps that are already checked, so
+            // this is amortized constant time per toggle
+            while (m_completedPrefix < m_checked.Size() && m_checked.Test(m_completedPrefix)) {
+                m_completedPrefix++;
+            }
+            // If this is not the last step, enable the next one
+            if (step + 1 == m_enabledCount && m_enabledCount < m_checked.Size()) {
+                m_enabledCount++;
+                RefreshRow(step + 1);
+            }
+        } else {
+            m_checkedCount--;
+            m_completedPrefix = std::min(m_completedPrefix, step);
+        }
+        m_onToggled(step);
+    }
+
+    void OnLeftDown(wxMouseEvent &event)
+    {
+        int row = HitTest(event.GetPosition());
+        if (row != wxNOT_FOUND) Toggle(static_cast<size_t>(row));
+        event.Skip(); // keep the default selection handling
+    }
+
+    void OnKeyDown(wxKeyEvent &event)
+    {
+        if (event.GetKeyCode() == WXK_SPACE && GetSelection() != wxNOT_FOUND) {
+            Toggle(static_cast<size_t>(GetSelection()));
+            // Move on to the first step still to do, so Space can be pressed repeatedly
+            if (m_completedPrefix < m_checked.Size()) {
+                SetSelection(static_cast<int>(m_completedPrefix));
+            }
+            return;
+        }
+        event.Skip();
+    }
+
+    void OnDrawItem(wxDC &dc, const wxRect &rect, size_t n) const override
+    {
+        int flags = 0;
+        if (m_checked.Test(n)) flags |= wxCONTROL_CHECKED;
+        if (!IsEnabled(n)) flags |= wxCONTROL_DISABLED;
+
+        StepListBox *self = const_cast<StepListBox*>(this);
+        wxSize box = wxRendererNative::Get().GetCheckBoxSize(self);
+        int margin = FromDIP(4);
+        wxRect boxRect(rect.x + margin, rect.y + (rect.height - box.y) / 2, box.x, box.y);
+        wxRendererNative::Get().DrawCheckBox(self, dc, boxRect, flags);
+
+        if (!IsEnabled(n))         dc.SetTextForeground(wxSystemSettings::GetColour(wxSYS_COLOUR_GRAYTEXT));
+        else if (IsSelected(n))    dc.SetTextForeground(wxSystemSettings::GetColour(wxSYS_COLOUR_HIGHLIGHTTEXT));
+        else                       dc.SetTextForeground(wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOWTEXT));
+        std::string_view step = m_task->steps[n];
+        wxString stepLabel = wxString::Format("%zu. ", n+1) + wxString(step.data(), step.size());
+        int textX = boxRect.x + box.x + margin;
+        dc.DrawText(stepLabel, textX, rect.y + (rect.height - dc.GetTextExtent(stepLabel).y) / 2);
+    }
+
+    wxCoord OnMeasureItem(size_t) const override
+    {
+        return GetCharHeight() + FromDIP(8);
+    }
+};
+
 class TaskStepsDialog : public wxDialog
 {
 public:
     TaskStepsDialog(wxWindow* parent,
                     const wxString& title,
-                    const Task &task)
-        : wxDialog(parent, wxID_ANY, title, wxDefaultPosition, wxSize(400, 300)),
+                    TaskHandle task)
+        : wxDialog(parent, wxID_ANY, title, wxDefaultPosition, wxSize(400, 300),
+                   wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER),
           m_task(task)
     {
+        ScopedTimer timer(Metric::StepsDialog);
         wxPanel *panel = new wxPanel(this, wxID_ANY);
         wxBoxSizer *mainSizer = new wxBoxSizer(wxVERTICAL);
 
@@ -149,67 +351,739 @@ public:
             "Check each step in order. You cannot check step i+1 before step i.");
         mainSizer->Add(label, 0, wxALL | wxEXPAND, 5);
 
-        // Create checkboxes for steps
-        for (size_t i=0; i<m_task.steps.size(); i++) {
-            wxString stepLabel = wxString::Format("%zu. %s", i+1, m_task.steps[i]);
-            wxCheckBox *cb = new wxCheckBox(panel, 1000 + i, stepLabel);
-            cb->Bind(wxEVT_CHECKBOX, &TaskStepsDialog::OnCheckBox, this);
-            mainSizer->Add(cb, 0, wxLEFT | wxRIGHT | wxTOP, 5);
-            m_checkBoxes.push_back(cb);
+        // Steps (only the visible rows are ever drawn)
+        m_steps = new StepListBox(panel, m_task, [this](size_t step) { OnStepToggled(step); });
+        mainSizer->Add(m_steps, 1, wxALL | wxEXPAND, 5);
+
+        // Progress + Finish button
+        wxBoxSizer *bottomSizer = new wxBoxSizer(wxHORIZONTAL);
+        m_progress = new wxStaticText(panel, wxID_ANY, "");
+        bottomSizer->Add(m_progress, 1, wxALIGN_CENTER_VERTICAL | wxLEFT, 5);
+        m_finishButton = new wxButton(panel, wxID_OK, "Finish");
+        m_finishButton->Bind(wxEVT_BUTTON, &TaskStepsDialog::OnFinish, this);
+        bottomSizer->Add(m_finishButton, 0, wxALL, 5);
+        mainSizer->Add(bottomSizer, 0, wxALL | wxEXPAND, 5);
+        UpdateProgress(); // Finish stays disabled until all steps are checked
+
+        panel->SetSizer(mainSizer);
+        mainSizer->Fit(this);
+    }
+
+private:
+    TaskHandle    m_task;
+    StepListBox  *m_steps;
+    wxStaticText *m_progress;
+    wxButton     *m_finishButton;
+
+    void OnStepToggled(size_t)
+    {
+        UpdateProgress();
+    }
+
+    // Constant time: reads the list's counters, never walks the steps
+    void UpdateProgress()
+    {
+        m_progress->SetLabel(wxString::Format("%zu/%zu steps", m_steps->CheckedCount(), m_steps->StepCount()));
+        // If all steps are done, enable the Finish button
+        m_finishButton->Enable(m_steps->AllChecked());
+    }
+
+    void OnFinish(wxCommandEvent &)
+    {
+        // All steps done, close dialog
+        EndModal(wxID_OK);
+    }
+};
+
+// --------------------------- ReportQueryDialog ---------------------------
+// Audit queries over the report journal: the reports of a date range,
+// optionally of one aircraft and/or system. Matches come from the journal
+// index; only the rows scrolled into view are read from the journal. The
+// matches can be exported as text reports.
+
+class JournalResultsCtrl : public wxListCtrl
+{
+public:
+    JournalResultsCtrl(wxWindow *parent, const ReportJournal &journal)
+        : wxListCtrl(parent, wxID_ANY, wxDefaultPosition, wxSize(700, 300),
+                     wxLC_REPORT | wxLC_VIRTUAL | wxLC_SINGLE_SEL),
+          m_journal(journal)
+    {
+        InsertReportColumns(this);
+    }
+
+    void SetResults(std::vector<uint32_t> &&positions)
+    {
+        m_positions = std::move(positions);
+        m_cachedRow = -1;
+        SetItemCount(static_cast<long>(m_positions.size()));
+        Refresh();
+    }
+
+    // Journal positions of the rows
+    const std::vector<uint32_t>& Results() const { return m_positions; }
+
+private:
+    const ReportJournal   &m_journal;
+    std::vector<uint32_t>  m_positions;
+
+    // A row is drawn column by column; read its record only once
+    mutable long         m_cachedRow = -1;
+    mutable ReportRecord m_cached;
+
+    wxString OnGetItemText(long item, long column) const override
+    {
+        if (item < 0 || static_cast<size_t>(item) >= m_positions.size()) return wxString();
+        if (item != m_cachedRow) {
+            MaintenanceReport report;
+            m_cached = m_journal.Read(m_positions[item], report) ? SummarizeReport(report) : ReportRecord{};
+            m_cachedRow = item;
+        }
+        return ReportColumnText(m_cached, column);
+    }
+};
+
+class ReportQueryDialog : public wxDialog
+{
+public:
+    ReportQueryDialog(wxWindow *parent, const ReportJournal &journal)
+        : wxDialog(parent, wxID_ANY, "Query Reports", wxDefaultPosition, wxSize(750, 450),
+                   wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER),
+          m_journal(journal)
+    {
+        wxPanel *panel = new wxPanel(this, wxID_ANY);
+        wxBoxSizer *mainSizer = new wxBoxSizer(wxVERTICAL);
+
+        // Filters; empty dates leave the range open
+        wxBoxSizer *filterSizer = new wxBoxSizer(wxHORIZONTAL);
+        m_from = new wxTextCtrl(panel, wxID_ANY, "", wxDefaultPosition, wxSize(90, -1));
+        m_from->SetHint("YYYY-MM-DD");
+        m_to = new wxTextCtrl(panel, wxID_ANY, "", wxDefaultPosition, wxSize(90, -1));
+        m_to->SetHint("YYYY-MM-DD");
+        m_aircraft = new wxChoice(panel, wxID_ANY);
+        FillChoice(m_aircraft, journal.Aircraft());
+        m_system = new wxChoice(panel, wxID_ANY);
+        FillChoice(m_system, journal.Systems());
+        wxButton *btnSearch = new wxButton(panel, wxID_ANY, "Search");
+        btnSearch->Bind(wxEVT_BUTTON, &ReportQueryDialog::OnSearch, this);
+
+        filterSizer->Add(new wxStaticText(panel, wxID_ANY, "From:"), 0, wxALIGN_CENTER_VERTICAL | wxALL, 5);
+        filterSizer->Add(m_from, 0, wxALL, 5);
+        filterSizer->Add(new wxStaticText(panel, wxID_ANY, "To:"), 0, wxALIGN_CENTER_VERTICAL | wxALL, 5);
+        filterSizer->Add(m_to, 0, wxALL, 5);
+        filterSizer->Add(new wxStaticText(panel, wxID_ANY, "Aircraft:"), 0, wxALIGN_CENTER_VERTICAL | wxALL, 5);
+        filterSizer->Add(m_aircraft, 0, wxALL, 5);
+        filterSizer->Add(new wxStaticText(panel, wxID_ANY, "System:"), 0, wxALIGN_CENTER_VERTICAL | wxALL, 5);
+        filterSizer->Add(m_system, 0, wxALL, 5);
+        filterSizer->Add(btnSearch, 0, wxALL, 5);
+        mainSizer->Add(filterSizer, 0, wxALL | wxEXPAND, 5);
+
+        m_results = new JournalResultsCtrl(panel, journal);
+        mainSizer->Add(m_results, 1, wxALL | wxEXPAND, 5);
+
+        // Match count + Export / Close buttons
+        wxBoxSizer *bottomSizer = new wxBoxSizer(wxHORIZONTAL);
+        m_count = new wxStaticText(panel, wxID_ANY, "");
+        bottomSizer->Add(m_count, 1, wxALIGN_CENTER_VERTICAL | wxLEFT, 5);
+        wxButton *btnExport = new wxButton(panel, wxID_ANY, "Export...");
+        btnExport->Bind(wxEVT_BUTTON, &ReportQueryDialog::OnExport, this);
+        bottomSizer->Add(btnExport, 0, wxALL, 5);
+        bottomSizer->Add(new wxButton(panel, wxID_CANCEL, "Close"), 0, wxALL, 5);
+        mainSizer->Add(bottomSizer, 0, wxALL | wxEXPAND, 5);
+
+        panel->SetSizer(mainSizer);
+        mainSizer->Fit(this);
+
+        // Start with every report
+        ShowResults(m_journal.Query(0, std::numeric_limits<uint32_t>::max(), "", ""));
+    }
+
+private:
+    const ReportJournal &m_journal;
+    wxTextCtrl         *m_from;
+    wxTextCtrl         *m_to;
+    wxChoice           *m_aircraft;
+    wxChoice           *m_system;
+    JournalResultsCtrl *m_results;
+    wxStaticText       *m_count;
+
+    // "(any)" followed by 'values'
+    static void FillChoice(wxChoice *choice, const std::vector<std::string> &values)
+    {
+        choice->Append("(any)");
+        for (auto &v : values) choice->Append(wxString::FromUTF8(v.c_str()));
+        choice->SetSelection(0);
+    }
+
+    static std::string ChoiceValue(const wxChoice *choice)
+    {
+        int sel = choice->GetSelection();
+        return sel > 0 ? choice->GetString(sel).ToStdString() : std::string();
+    }
+
+    void ShowResults(std::vector<uint32_t> &&positions)
+    {
+        m_count->SetLabel(wxString::Format("%zu reports", positions.size()));
+        m_results->SetResults(std::move(positions));
+    }
+
+    void OnSearch(wxCommandEvent &)
+    {
+        auto parseDate = [](const wxTextCtrl *ctrl, uint32_t &date) {
+            std::string text = ctrl->GetValue().ToStdString();
+            if (text.empty()) return true; // open end
+            date = ParseReportDate(text);
+            return date != 0;
+        };
+        uint32_t from = 0, to = std::numeric_limits<uint32_t>::max();
+        if (!parseDate(m_from, from) || !parseDate(m_to, to)) {
+            wxMessageBox("Dates must be written as YYYY-MM-DD.", "Query Reports", wxOK | wxICON_WARNING);
+            return;
+        }
+        ShowResults(m_journal.Query(from, to, ChoiceValue(m_aircraft), ChoiceValue(m_system)));
+    }
+
+    // Write the matching reports as text reports, CSV or JSON lines (the
+    // format follows the chosen file type)
+    void OnExport(wxCommandEvent &)
+    {
+        wxFileDialog dlg(this, "Export reports", "", "reports.txt",
+                         "Text files (*.txt)|*.txt|CSV files (*.csv)|*.csv|JSON lines (*.jsonl)|*.jsonl",
+                         wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+        if (dlg.ShowModal() != wxID_OK) return;
+        static const ReportFormat kFormats[] = {ReportFormat::Text, ReportFormat::Csv, ReportFormat::JsonLines};
+        int filter = dlg.GetFilterIndex();
+        ReportFormat format = filter >= 0 && filter < 3 ? kFormats[filter] : ReportFormat::Text;
+
+        // Reports still queued for the writer are not in the journal file yet
+        g_reportWriter.Flush();
+        size_t unreadable = 0;
+        if (!ExportReports(m_journal, m_results->Results(), format, dlg.GetPath().ToStdString(), unreadable)) {
+            wxMessageBox("Could not write " + dlg.GetPath(), "Query Reports", wxOK | wxICON_ERROR);
+        } else if (unreadable) {
+            wxMessageBox(wxString::Format("%zu reports could not be read from the journal.", unreadable),
+                         "Query Reports", wxOK | wxICON_WARNING);
+        }
+    }
+};
+
+// --------------------------- WorkPackageDialog ---------------------------
+// Planning view of the work package: its cards and, for every part they
+// need, the total demand against the current stock, with the parts the stock
+// cannot cover in red. Both lists are virtual and read the package as rows
+// are drawn; the demand itself is kept up to date by WorkPackage as cards
+// come and go and stock changes.
+
+class PlannedTaskListCtrl : public wxListCtrl
+{
+public:
+    PlannedTaskListCtrl(wxWindow *parent, const WorkPackage &package)
+        : wxListCtrl(parent, wxID_ANY, wxDefaultPosition, wxSize(420, 280), wxLC_REPORT | wxLC_VIRTUAL),
+          m_package(package)
+    {
+        InsertColumn(0, "Aircraft", wxLIST_FORMAT_LEFT, 100);
+        InsertColumn(1, "System", wxLIST_FORMAT_LEFT, 100);
+        InsertColumn(2, "Task", wxLIST_FORMAT_LEFT, 200);
+        RefreshRows();
+    }
+
+    void RefreshRows()
+    {
+        SetItemCount(static_cast<long>(m_package.Size()));
+        Refresh();
+    }
+
+    // Selected rows, last first (so they can be removed in turn)
+    std::vector<size_t> SelectedRows() const
+    {
+        std::vector<size_t> rows;
+        for (long row = GetNextItem(-1, wxLIST_NEXT_ALL, wxLIST_STATE_SELECTED); row != -1;
+             row = GetNextItem(row, wxLIST_NEXT_ALL, wxLIST_STATE_SELECTED)) {
+            rows.push_back(static_cast<size_t>(row));
+        }
+        std::reverse(rows.begin(), rows.end());
+        return rows;
+    }
+
+private:
+    const WorkPackage &m_package;
+
+    wxString OnGetItemText(long item, long column) const override
+    {
+        if (item < 0 || static_cast<size_t>(item) >= m_package.Size()) return wxString();
+        const PlannedTask &t = m_package[static_cast<size_t>(item)];
+        switch (column) {
+            case 0:  return wxString::FromUTF8(t.aircraft.c_str());
+            case 1:  return wxString::FromUTF8(t.system.c_str());
+            default: return wxString::FromUTF8(std::string(t.task->name).c_str());
+        }
+    }
+};
+
+class PartForecastCtrl : public wxListCtrl
+{
+public:
+    PartForecastCtrl(wxWindow *parent, const WorkPackage &package)
+        : wxListCtrl(parent, wxID_ANY, wxDefaultPosition, wxSize(330, 280),
+                     wxLC_REPORT | wxLC_VIRTUAL | wxLC_SINGLE_SEL),
+          m_package(package)
+    {
+        InsertColumn(0, "Part", wxLIST_FORMAT_LEFT, 140);
+        InsertColumn(1, "Needed", wxLIST_FORMAT_RIGHT, 60);
+        InsertColumn(2, "In Stock", wxLIST_FORMAT_RIGHT, 60);
+        InsertColumn(3, "Short", wxLIST_FORMAT_RIGHT, 60);
+        m_shortAttr.SetTextColour(wxColour(200, 0, 0));
+        RefreshRows();
+    }
+
+    void RefreshRows()
+    {
+        SetItemCount(static_cast<long>(m_package.Parts().size()));
+        Refresh();
+    }
+
+private:
+    const WorkPackage &m_package;
+    mutable wxItemAttr m_shortAttr;
+
+    wxString OnGetItemText(long item, long column) const override
+    {
+        if (item < 0 || static_cast<size_t>(item) >= m_package.Parts().size()) return wxString();
+        PartId part = m_package.Parts()[static_cast<size_t>(item)];
+        switch (column) {
+            case 0:  return g_partRegistry.Name(part);
+            case 1:  return std::to_string(m_package.Demand(part));
+            case 2:  return std::to_string(stockInventory.Quantity(part));
+            default: return m_package.IsShort(part) ? std::to_string(m_package.Shortfall(part)) : std::string();
+        }
+    }
+
+    wxItemAttr* OnGetItemAttr(long item) const override
+    {
+        if (item < 0 || static_cast<size_t>(item) >= m_package.Parts().size()) return nullptr;
+        return m_package.IsShort(m_package.Parts()[static_cast<size_t>(item)]) ? &m_shortAttr : nullptr;
+    }
+};
+
+class WorkPackageDialog : public wxDialog
+{
+public:
+    WorkPackageDialog(wxWindow *parent, WorkPackage &package)
+        : wxDialog(parent, wxID_ANY, "Work Package", wxDefaultPosition, wxSize(800, 450),
+                   wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER),
+          m_package(package)
+    {
+        wxPanel *panel = new wxPanel(this, wxID_ANY);
+        wxBoxSizer *mainSizer = new wxBoxSizer(wxVERTICAL);
+
+        // Planned cards | part forecast
+        wxBoxSizer *listSizer = new wxBoxSizer(wxHORIZONTAL);
+        wxBoxSizer *taskSizer = new wxBoxSizer(wxVERTICAL);
+        taskSizer->Add(new wxStaticText(panel, wxID_ANY, "Planned Tasks:"), 0, wxALL, 5);
+        m_tasks = new PlannedTaskListCtrl(panel, package);
+        taskSizer->Add(m_tasks, 1, wxALL | wxEXPAND, 5);
+        wxBoxSizer *partSizer = new wxBoxSizer(wxVERTICAL);
+        partSizer->Add(new wxStaticText(panel, wxID_ANY, "Parts Forecast:"), 0, wxALL, 5);
+        m_forecast = new PartForecastCtrl(panel, package);
+        partSizer->Add(m_forecast, 1, wxALL | wxEXPAND, 5);
+        listSizer->Add(taskSizer, 1, wxEXPAND);
+        listSizer->Add(partSizer, 1, wxEXPAND);
+        mainSizer->Add(listSizer, 1, wxALL | wxEXPAND, 5);
+
+        // Summary + Load / Remove / Clear / Close buttons
+        wxBoxSizer *bottomSizer = new wxBoxSizer(wxHORIZONTAL);
+        m_summary = new wxStaticText(panel, wxID_ANY, "");
+        bottomSizer->Add(m_summary, 1, wxALIGN_CENTER_VERTICAL | wxLEFT, 5);
+        wxButton *btnLoad = new wxButton(panel, wxID_ANY, "Add Work Orders...");
+        btnLoad->Bind(wxEVT_BUTTON, &WorkPackageDialog::OnLoadOrders, this);
+        bottomSizer->Add(btnLoad, 0, wxALL, 5);
+        wxButton *btnRemove = new wxButton(panel, wxID_ANY, "Remove");
+        btnRemove->Bind(wxEVT_BUTTON, &WorkPackageDialog::OnRemove, this);
+        bottomSizer->Add(btnRemove, 0, wxALL, 5);
+        wxButton *btnClear = new wxButton(panel, wxID_ANY, "Clear");
+        btnClear->Bind(wxEVT_BUTTON, &WorkPackageDialog::OnClear, this);
+        bottomSizer->Add(btnClear, 0, wxALL, 5);
+        bottomSizer->Add(new wxButton(panel, wxID_CANCEL, "Close"), 0, wxALL, 5);
+        mainSizer->Add(bottomSizer, 0, wxALL | wxEXPAND, 5);
+
+        panel->SetSizer(mainSizer);
+        mainSizer->Fit(this);
+        UpdateSummary();
+    }
+
+    // The stock changed while the dialog is open (the package is already
+    // re-checked): redraw the forecast
+    void StockChanged()
+    {
+        m_forecast->Refresh();
+        UpdateSummary();
+    }
+
+private:
+    WorkPackage         &m_package;
+    PlannedTaskListCtrl *m_tasks;
+    PartForecastCtrl    *m_forecast;
+    wxStaticText        *m_summary;
+
+    void UpdateViews()
+    {
+        m_tasks->RefreshRows();
+        m_forecast->RefreshRows();
+        UpdateSummary();
+    }
+
+    void UpdateSummary()
+    {
+        m_summary->SetLabel(wxString::Format("%zu tasks, %zu parts, %zu short", m_package.Size(),
+                                             m_package.Parts().size(), m_package.ShortCount()));
+    }
+
+    // Plan every card of a work-order file (aircraft|system|task lines)
+    void OnLoadOrders(wxCommandEvent &)
+    {
+        wxFileDialog dlg(this, "Add work orders to the package", "", "",
+                         "Work orders (*.txt)|*.txt|All files|*", wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+        if (dlg.ShowModal() != wxID_OK) return;
+
+        std::vector<WorkOrder> orders;
+        if (!LoadWorkOrdersFromFile(dlg.GetPath().ToStdString(), orders)) return;
+        WorkOrderResolver resolver(CatalogSnapshot());
+        std::string errors, error;
+        for (auto &order : orders) {
+            TaskHandle task = resolver.Resolve(order, error);
+            if (!task) {
+                errors += error + "\n";
+                continue;
+            }
+            m_package.Add(order.aircraft, order.system, std::move(task));
+        }
+        UpdateViews();
+        if (!errors.empty()) {
+            wxMessageBox("These work orders were not added:\n" + errors, "Work Package", wxOK | wxICON_WARNING);
+        }
+    }
+
+    void OnRemove(wxCommandEvent &)
+    {
+        for (size_t row : m_tasks->SelectedRows()) m_package.Remove(row);
+        m_tasks->SetItemState(-1, 0, wxLIST_STATE_SELECTED);
+        UpdateViews();
+    }
+
+    void OnClear(wxCommandEvent &)
+    {
+        m_package.Clear();
+        UpdateViews();
+    }
+};
+
+// --------------------------- TaskListCtrl ---------------------------
+// Virtual (owner-data) list of one system's tasks. Only the item count is
+// handed to the native control; row text is fetched from the task vector
+// when a row is drawn, so filling the list costs the same for 10 or 10k tasks.
+// A row index is the task's index in that vector.
+
+class TaskListCtrl : public wxListCtrl
+{
+public:
+    TaskListCtrl(wxWindow *parent)
+        : wxListCtrl(parent, wxID_ANY, wxDefaultPosition, wxSize(250, 200),
+                     wxLC_REPORT | wxLC_VIRTUAL | wxLC_SINGLE_SEL | wxLC_NO_HEADER)
+    {
+        InsertColumn(0, "Task", wxLIST_FORMAT_LEFT, 240);
+    }
+
+    // Show 'tasks' (a system of 'catalog', which the list keeps alive).
+    // With redraw=false the visible rows are assumed unchanged.
+    void SetTasks(std::shared_ptr<const TaskCatalog> catalog, const TaskCatalog::TaskList &tasks,
+                  bool redraw = true)
+    {
+        m_catalog = std::move(catalog);
+        m_tasks = tasks;
+        long count = static_cast<long>(tasks.size());
+        if (count != GetItemCount()) SetItemCount(count);
+        if (redraw) Refresh();
+    }
+
+    void SelectRow(long row)
+    {
+        SetItemState(row, wxLIST_STATE_SELECTED | wxLIST_STATE_FOCUSED,
+                     wxLIST_STATE_SELECTED | wxLIST_STATE_FOCUSED);
+        EnsureVisible(row);
+    }
+
+    // Selected row, or wxNOT_FOUND
+    long GetSelection() const
+    {
+        return GetNextItem(-1, wxLIST_NEXT_ALL, wxLIST_STATE_SELECTED);
+    }
+
+    void ClearSelection()
+    {
+        long sel = GetSelection();
+        if (sel != wxNOT_FOUND) SetItemState(sel, 0, wxLIST_STATE_SELECTED);
+    }
+
+private:
+    std::shared_ptr<const TaskCatalog> m_catalog;
+    TaskCatalog::TaskList              m_tasks;
+
+    wxString OnGetItemText(long item, long) const override
+    {
+        if (item < 0 || static_cast<size_t>(item) >= m_tasks.size()) return wxString();
+        std::string_view name = m_tasks[item].name;
+        return wxString(name.data(), name.size());
+    }
+};
+
+// --------------------------- TaskSearchCtrl ---------------------------
+// Virtual list of search hits (task, system) across the whole catalog. Rows
+// are catalog-wide task indices into the snapshot the hits came from.
+
+class TaskSearchCtrl : public wxListCtrl
+{
+public:
+    TaskSearchCtrl(wxWindow *parent)
+        : wxListCtrl(parent, wxID_ANY, wxDefaultPosition, wxSize(250, 140),
+                     wxLC_REPORT | wxLC_VIRTUAL | wxLC_SINGLE_SEL)
+    {
+        InsertColumn(0, "Task", wxLIST_FORMAT_LEFT, 150);
+        InsertColumn(1, "System", wxLIST_FORMAT_LEFT, 90);
+    }
+
+    // Takes 'results' and hands back the previous list's buffer in it, so
+    // the next search fills storage that is already allocated
+    void SetResults(std::shared_ptr<const TaskCatalog> catalog, std::vector<uint32_t> &results)
+    {
+        m_catalog = std::move(catalog);
+        m_results.swap(results);
+        SetItemCount(static_cast<long>(m_results.size()));
+        Refresh();
+    }
+
+    const std::shared_ptr<const TaskCatalog> &Catalog() const { return m_catalog; }
+
+    // Catalog-wide task index of 'row'
+    uint32_t ResultAt(long row) const { return m_results[row]; }
+    size_t ResultCount() const { return m_results.size(); }
+
+private:
+    std::shared_ptr<const TaskCatalog> m_catalog;
+    std::vector<uint32_t>              m_results;
+
+    wxString OnGetItemText(long item, long column) const override
+    {
+        if (!m_catalog || item < 0 || static_cast<size_t>(item) >= m_results.size()) return wxString();
+        std::string_view text = column == 0 ? m_catalog->TaskAt(m_results[item]).name
+                                            : m_catalog->SystemName(m_catalog->SystemOf(m_results[item]));
+        return wxString(text.data(), text.size());
+    }
+};
+
+// --------------------------- StockListCtrl ---------------------------
+// Virtual two-column view of stockParts (part name, quantity). Quantities are
+// read from stockInventory when a row is drawn, so after a deduction only the
+// rows of the changed parts need to be refreshed.
+
+class StockListCtrl : public wxListCtrl
+{
+public:
+    StockListCtrl(wxWindow *parent)
+        : wxListCtrl(parent, wxID_ANY, wxDefaultPosition, wxSize(300, 120),
+                     wxLC_REPORT | wxLC_VIRTUAL | wxLC_SINGLE_SEL)
+    {
+        InsertColumn(0, "Part", wxLIST_FORMAT_LEFT, 200);
+        InsertColumn(1, "Qty", wxLIST_FORMAT_RIGHT, 80);
+    }
+
+    // Re-read the set of stocked parts (after stock.txt was (re)loaded)
+    void Rebuild()
+    {
+        m_rowOfPart.assign(g_partRegistry.Size(), wxNOT_FOUND);
+        for (size_t row=0; row<stockParts.size(); row++) {
+            m_rowOfPart[stockParts[row]] = static_cast<long>(row);
+        }
+        SetItemCount(static_cast<long>(stockParts.size()));
+        Refresh();
+    }
+
+    // Redraw only the rows showing the given parts
+    void RefreshParts(const std::vector<PartId> &parts)
+    {
+        for (PartId id : parts) {
+            if (id < m_rowOfPart.size() && m_rowOfPart[id] != wxNOT_FOUND) {
+                RefreshItem(m_rowOfPart[id]);
+            }
+        }
+    }
+
+    size_t RowCount() const { return static_cast<size_t>(GetItemCount()); }
+
+private:
+    std::vector<long> m_rowOfPart; // PartId -> row, wxNOT_FOUND if not stocked
+
+    wxString OnGetItemText(long item, long column) const override
+    {
+        if (item < 0 || static_cast<size_t>(item) >= stockParts.size()) return wxString();
+        PartId id = stockParts[item];
+        if (column == 0) return g_partRegistry.Name(id);
+        return std::to_string(stockInventory.Quantity(id));
+    }
+};
+
+// --------------------------- FilteredChooser ---------------------------
+// Type-ahead chooser for long lists: a filter box above a virtual list of the
+// entries containing the typed text (case-insensitive). Filling the list only
+// sets an item count and filtering is one pass over pre-lowered strings, so
+// hundreds of entries cost nothing noticeable. Enter or Down in the filter box
+// picks the first match.
+
+class FilteredChooser : public wxPanel
+{
+public:
+    FilteredChooser(wxWindow *parent, const wxString &hint, const wxSize &listSize,
+                    std::function<void(const std::string&)> onSelect)
+        : wxPanel(parent, wxID_ANY), m_onSelect(std::move(onSelect))
+    {
+        m_filter = new wxSearchCtrl(this, wxID_ANY, "", wxDefaultPosition, wxDefaultSize, wxTE_PROCESS_ENTER);
+        m_filter->SetHint(hint);
+        m_filter->ShowCancelButton(true);
+        m_filter->Bind(wxEVT_TEXT, &FilteredChooser::OnFilterText, this);
+        m_filter->Bind(wxEVT_TEXT_ENTER, &FilteredChooser::OnFilterEnter, this);
+        m_filter->Bind(wxEVT_SEARCHCTRL_CANCEL_BTN, &FilteredChooser::OnFilterCancel, this);
+        m_filter->Bind(wxEVT_KEY_DOWN, &FilteredChooser::OnFilterKey, this);
+
+        m_list = new ItemList(this, listSize);
+        m_list->Bind(wxEVT_LIST_ITEM_SELECTED, &FilteredChooser::OnItemSelected, this);
+
+        wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
+        sizer->Add(m_filter, 0, wxEXPAND | wxBOTTOM, 2);
+        sizer->Add(m_list, 1, wxEXPAND);
+        SetSizer(sizer);
+    }
+
+    // Replace the entries; the selection is kept if it is still one of them
+    void SetItems(std::vector<std::string> items)
+    {
+        m_items = std::move(items);
+        m_lowered.resize(m_items.size());
+        for (size_t i = 0; i < m_items.size(); i++) m_lowered[i] = Lower(m_items[i]);
+        if (std::find(m_items.begin(), m_items.end(), m_selected) == m_items.end()) m_selected.clear();
+        ApplyFilter();
+    }
+
+    // Selected entry, or empty
+    const std::string &Selection() const { return m_selected; }
+
+    // Select 'item' without notifying, clearing the filter if it hides it
+    void Select(const std::string &item)
+    {
+        if (std::find(m_items.begin(), m_items.end(), item) == m_items.end()) return;
+        m_selected = item;
+        if (Lower(item).find(Lower(m_filter->GetValue().utf8_string())) == std::string::npos) {
+            m_filter->ChangeValue("");
+        }
+        ApplyFilter();
+    }
+
+private:
+    // Virtual rows: m_shown[row] indexes m_items
+    class ItemList : public wxListCtrl
+    {
+    public:
+        ItemList(FilteredChooser *owner, const wxSize &size)
+            : wxListCtrl(owner, wxID_ANY, wxDefaultPosition, size,
+                         wxLC_REPORT | wxLC_VIRTUAL | wxLC_SINGLE_SEL | wxLC_NO_HEADER),
+              m_owner(owner)
+        {
+            InsertColumn(0, "", wxLIST_FORMAT_LEFT, size.x - 20);
+        }
+
+    private:
+        FilteredChooser *m_owner;
+
+        wxString OnGetItemText(long item, long) const override
+        {
+            if (item < 0 || static_cast<size_t>(item) >= m_owner->m_shown.size()) return wxString();
+            return wxString::FromUTF8(m_owner->m_items[m_owner->m_shown[item]]);
+        }
+    };
+
+    wxSearchCtrl                            *m_filter;
+    ItemList                                *m_list;
+    std::function<void(const std::string&)>  m_onSelect;
+    std::vector<std::string>                 m_items;
+    std::vector<std::string>                 m_lowered; // parallel to m_items
+    std::vector<uint32_t>                    m_shown;   // entries passing the filter
+    std::string                              m_selected;
+    bool                                     m_updating = false; // ignore our own selection changes
+
+    static std::string Lower(std::string s)
+    {
+        for (char &c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return s;
+    }
+
+    // Rebuild m_shown and re-select m_selected if it is shown
+    void ApplyFilter()
+    {
+        std::string needle = Lower(m_filter->GetValue().utf8_string());
+        m_shown.clear();
+        long selectedRow = wxNOT_FOUND;
+        for (size_t i = 0; i < m_items.size(); i++) {
+            if (!needle.empty() && m_lowered[i].find(needle) == std::string::npos) continue;
+            if (m_items[i] == m_selected) selectedRow = static_cast<long>(m_shown.size());
+            m_shown.push_back(static_cast<uint32_t>(i));
         }
 
-        // Initially, only the first checkbox is enabled
-        for (size_t i=1; i<m_checkBoxes.size(); i++) {
-            m_checkBoxes[i]->Enable(false);
+        m_updating = true;
+        long old = m_list->GetNextItem(-1, wxLIST_NEXT_ALL, wxLIST_STATE_SELECTED);
+        if (old != wxNOT_FOUND) m_list->SetItemState(old, 0, wxLIST_STATE_SELECTED);
+        m_list->SetItemCount(static_cast<long>(m_shown.size()));
+        if (selectedRow != wxNOT_FOUND) {
+            m_list->SetItemState(selectedRow, wxLIST_STATE_SELECTED | wxLIST_STATE_FOCUSED,
+                                 wxLIST_STATE_SELECTED | wxLIST_STATE_FOCUSED);
+            m_list->EnsureVisible(selectedRow);
         }
+        m_list->Refresh();
+        m_updating = false;
+    }
 
-        // Finish button
-        m_finishButton = new wxButton(panel, wxID_OK, "Finish");
-        m_finishButton->Bind(wxEVT_BUTTON, &TaskStepsDialog::OnFinish, this);
-        m_finishButton->Enable(false); // disabled until all steps are checked
-        mainSizer->Add(m_finishButton, 0, wxALL | wxALIGN_RIGHT, 10);
-
-        panel->SetSizer(mainSizer);
-        mainSizer->Fit(this);
+    void PickRow(long row)
+    {
+        if (row < 0 || static_cast<size_t>(row) >= m_shown.size()) return;
+        m_list->SetItemState(row, wxLIST_STATE_SELECTED | wxLIST_STATE_FOCUSED,
+                             wxLIST_STATE_SELECTED | wxLIST_STATE_FOCUSED);
+        m_list->EnsureVisible(row);
     }
 
-private:
-    Task m_task;
-    std::vector<wxCheckBox*> m_checkBoxes;
-    wxButton *m_finishButton;
-
-    void OnCheckBox(wxCommandEvent &event)
-    {
-        // Find which checkbox triggered
-        wxCheckBox *cb = dynamic_cast<wxCheckBox*>(event.GetEventObject());
-        if (!cb) return;
-
-        // If this is not the last step, enable the next step's checkbox
-        for (size_t i=0; i<m_checkBoxes.size(); i++) {
-            if (m_checkBoxes[i] == cb && cb->IsChecked()) {
-                // enable the next
-                if (i+1 < m_checkBoxes.size()) {
-                    m_checkBoxes[i+1]->Enable(true);
-                }
-            }
-        }
+    void OnFilterText(wxCommandEvent &) { ApplyFilter(); }
 
-        // Check if all are checked
-        bool allChecked = true;
-        for (auto &c : m_checkBoxes) {
-            if (!c->IsChecked()) {
-                allChecked = false;
-                break;
-            }
+    void OnFilterEnter(wxCommandEvent &) { PickRow(0); }
+
+    void OnFilterCancel(wxCommandEvent &)
+    {
+        m_filter->ChangeValue("");
+        ApplyFilter();
+    }
+
+    void OnFilterKey(wxKeyEvent &event)
+    {
+        if (event.GetKeyCode() == WXK_DOWN && !m_shown.empty()) {
+            m_list->SetFocus();
+            PickRow(0);
+            return;
         }
-        // If all steps are done, enable the Finish button
-        m_finishButton->Enable(allChecked);
+        event.Skip();
     }
 
-    void OnFinish(wxCommandEvent &)
+    void OnItemSelected(wxListEvent &event)
     {
-        // All steps done, close dialog
-        EndModal(wxID_OK);
+        if (m_updating) return;
+        long row = event.GetIndex();
+        if (row < 0 || static_cast<size_t>(row) >= m_shown.size()) return;
+        m_selected = m_items[m_shown[row]];
+        if (m_onSelect) m_onSelect(m_selected);
     }
 };
 
@@ -221,18 +1095,12 @@ public:
     AircraftSelectPanel(wxWindow *parent)
         : wxPanel(parent, wxID_ANY, wxDefaultPosition, wxDefaultSize, 0, "AircraftSelectPanel")
     {
-        // Some example aircraft
-        m_aircraftTypes = {"Boeing 737", "Airbus A320", "Gulfstream G550"};
-
         wxBoxSizer *mainSizer = new wxBoxSizer(wxVERTICAL);
         wxStaticText *title = new wxStaticText(this, wxID_ANY, "Select Aircraft to Service:");
         mainSizer->Add(title, 0, wxALL, 10);
 
-        m_choice = new wxChoice(this, wxID_ANY);
-        for (auto &ac : m_aircraftTypes) {
-            m_choice->Append(ac);
-        }
-        mainSizer->Add(m_choice, 0, wxALL | wxEXPAND, 10);
+        m_chooser = new FilteredChooser(this, "Tail number or type...", wxSize(300, 240), nullptr);
+        mainSizer->Add(m_chooser, 1, wxALL | wxEXPAND, 10);
 
         wxButton *btnSelect = new wxButton(this, wxID_ANY, "Confirm Aircraft");
         btnSelect->Bind(wxEVT_BUTTON, &AircraftSelectPanel::OnConfirmAircraft, this);
@@ -241,24 +1109,41 @@ public:
         SetSizer(mainSizer);
     }
 
+    // Fill the chooser from the fleet file contents
+    void SetFleet(std::vector<Aircraft> fleet)
+    {
+        m_fleet = std::move(fleet);
+        std::vector<std::string> labels;
+        labels.reserve(m_fleet.size());
+        for (auto &ac : m_fleet) labels.push_back(ac.Label());
+        m_chooser->SetItems(std::move(labels));
+    }
+
 private:
-    wxChoice *m_choice;
-    std::vector<std::string> m_aircraftTypes;
+    FilteredChooser      *m_chooser;
+    std::vector<Aircraft> m_fleet;
 
     void OnConfirmAircraft(wxCommandEvent &)
     {
-        int sel = m_choice->GetSelection();
-        if (sel == wxNOT_FOUND) {
+        const std::string &sel = m_chooser->Selection();
+        if (sel.empty()) {
             wxMessageBox("Please select an aircraft.", "Error", wxOK | wxICON_ERROR);
             return;
         }
-        g_chosenAircraft = m_choice->GetString(sel).ToStdString();
-        wxMessageBox("Chosen Aircraft: " + m_choice->GetString(sel), "Info", wxOK | wxICON_INFORMATION);
+        g_chosenAircraft = sel;
+        g_chosenAircraftType.clear();
+        for (auto &ac : m_fleet) {
+            if (ac.Label() == sel) {
+                g_chosenAircraftType = ac.type;
+                break;
+            }
+        }
+        wxMessageBox("Chosen Aircraft: " + wxString::FromUTF8(sel), "Info", wxOK | wxICON_INFORMATION);
 
         // Parent is MainFrame
         wxFrame* parentFrame = dynamic_cast<wxFrame*>(GetParent());
         if (parentFrame) {
-            parentFrame->SetTitle("MRO Management System - " + m_choice->GetString(sel));
+            parentFrame->SetTitle("MRO Management System - " + wxString::FromUTF8(sel));
         }
 
         // Hide this panel, show the MaintenancePanel
@@ -271,6 +1156,61 @@ private:
     }
 };
 
+// --------------------------- Task Details ---------------------------
+// Detail text of the most recently shown tasks, rendered once per task. The
+// entries belong to one catalog snapshot; a reload starts over.
+
+class TaskDetailsCache
+{
+public:
+    static const size_t kCapacity = 256;
+
+    const wxString& Get(const TaskHandle &task)
+    {
+        if (m_catalog.lock() != task.catalog) {
+            m_entries.clear();
+            m_catalog = task.catalog;
+        }
+        auto it = m_entries.find(task.id);
+        if (it == m_entries.end()) {
+            if (m_entries.size() >= kCapacity) {
+                // Drop the least recently shown task
+                auto oldest = std::min_element(m_entries.begin(), m_entries.end(),
+                    [](const auto &a, const auto &b) { return a.second.used < b.second.used; });
+                m_entries.erase(oldest);
+            }
+            it = m_entries.emplace(task.id, Entry{wxString(Render(*task)), 0}).first;
+        }
+        it->second.used = ++m_clock;
+        return it->second.text;
+    }
+
+private:
+    struct Entry {
+        wxString text;
+        uint64_t used;
+    };
+
+    std::weak_ptr<const TaskCatalog>    m_catalog;
+    std::unordered_map<size_t, Entry>   m_entries;
+    uint64_t                            m_clock = 0;
+
+    static std::string Render(const Task &task)
+    {
+        std::string text;
+        text.reserve(64 + task.name.size() + task.steps.size() * 48 + task.requiredParts.size() * 24);
+        text.append("Task Name: ").append(task.name).append("\n\nSteps:\n");
+        for (size_t i=0; i<task.steps.size(); i++) {
+            text.append(std::to_string(i+1)).append(". ").append(task.steps[i]).append("\n");
+        }
+        text.append("\nRequired Parts:\n");
+        for (auto &d : task.requiredParts) {
+            text.append("- ").append(PartLabel(d)).append("\n");
+        }
+        return text;
+    }
+};
+
 // --------------------------- MaintenancePanel -----------------------------
 
 class MaintenancePanel : public wxPanel
@@ -281,16 +1221,24 @@ public:
     {
         wxPanel *panel = this;
         wxStaticText *labSys = new wxStaticText(panel, wxID_ANY, "Select System:");
-        m_systemChoice = new wxChoice(panel, wxID_ANY);
-        m_systemChoice->Append("Avionics");
-        m_systemChoice->Append("Hydraulic");
-        m_systemChoice->Append("Mechanical");
-        m_systemChoice->Bind(wxEVT_CHOICE, &MaintenancePanel::OnSelectSystem, this);
+        m_systemChooser = new FilteredChooser(panel, "Filter systems...", wxSize(250, 110),
+                                              [this](const std::string &system) { OnSelectSystem(system); });
+
+        // Full-text search over task names, steps and parts
+        wxStaticText *labSearch = new wxStaticText(panel, wxID_ANY, "Search Tasks:");
+        m_search = new wxSearchCtrl(panel, wxID_ANY, "", wxDefaultPosition, wxSize(250, -1));
+        m_search->ShowCancelButton(true);
+        m_search->SetHint("Name, step or part...");
+        m_search->Bind(wxEVT_TEXT, &MaintenancePanel::OnSearchText, this);
+        m_search->Bind(wxEVT_SEARCHCTRL_CANCEL_BTN, &MaintenancePanel::OnSearchCancel, this);
+        m_searchResults = new TaskSearchCtrl(panel);
+        m_searchResults->Bind(wxEVT_LIST_ITEM_SELECTED, &MaintenancePanel::OnSearchResultSelected, this);
 
         // Task List
         wxStaticText *labTasks = new wxStaticText(panel, wxID_ANY, "Available Tasks:");
-        m_taskList = new wxListBox(panel, wxID_ANY);
-        m_taskList->Bind(wxEVT_LISTBOX, &MaintenancePanel::OnTaskSelected, this);
+        m_taskList = new TaskListCtrl(panel);
+        m_taskList->Bind(wxEVT_LIST_ITEM_SELECTED, &MaintenancePanel::OnTaskSelected, this);
+        m_taskList->Bind(wxEVT_LIST_ITEM_DESELECTED, &MaintenancePanel::OnTaskDeselected, this);
 
         // Task Details
         wxStaticText *labDetails = new wxStaticText(panel, wxID_ANY, "Task Details:");
@@ -300,18 +1248,34 @@ public:
         m_startStepsButton = new wxButton(panel, wxID_ANY, "Start Task Steps");
         m_startStepsButton->Bind(wxEVT_BUTTON, &MaintenancePanel::OnStartSteps, this);
         m_startStepsButton->Enable(false);
+        Bind(wxEVT_SHOW, &MaintenancePanel::OnShown, this);
+
+        // Work package planning: demand of the planned cards against the stock
+        m_addToPackageButton = new wxButton(panel, wxID_ANY, "Add to Work Package");
+        m_addToPackageButton->Bind(wxEVT_BUTTON, &MaintenancePanel::OnAddToPackage, this);
+        m_addToPackageButton->Enable(false);
+        wxButton *btnPackage = new wxButton(panel, wxID_ANY, "Work Package...");
+        btnPackage->Bind(wxEVT_BUTTON, &MaintenancePanel::OnShowPackage, this);
 
         // Change Aircraft (go back) Button
         wxButton *btnChangeAircraft = new wxButton(panel, wxID_ANY, "Change Aircraft");
         btnChangeAircraft->Bind(wxEVT_BUTTON, &MaintenancePanel::OnChangeAircraft, this);
 
+        // Batch import of cards completed on the line
+        wxButton *btnImportBatch = new wxButton(panel, wxID_ANY, "Import Completed Cards...");
+        btnImportBatch->Bind(wxEVT_BUTTON, &MaintenancePanel::OnImportBatch, this);
+
+        // Audit queries over the report journal
+        wxButton *btnQueryReports = new wxButton(panel, wxID_ANY, "Query Reports...");
+        btnQueryReports->Bind(wxEVT_BUTTON, &MaintenancePanel::OnQueryReports, this);
+
         // Stock Display
         wxStaticText *labStock = new wxStaticText(panel, wxID_ANY, "Current Stock:");
-        m_stockDisplay = new wxTextCtrl(panel, wxID_ANY, "", wxDefaultPosition, wxSize(300, 120), wxTE_MULTILINE | wxTE_READONLY);
+        m_stockDisplay = new StockListCtrl(panel);
 
         // Report Output
         wxStaticText *labReport = new wxStaticText(panel, wxID_ANY, "Maintenance Report Log:");
-        m_reportOutput = new wxTextCtrl(panel, wxID_ANY, "", wxDefaultPosition, wxSize(400, 150), wxTE_MULTILINE | wxTE_READONLY);
+        m_reportOutput = new ReportLogCtrl(panel, g_reportWriter.Filename());
 
         // Layout
         wxBoxSizer *mainSizer = new wxBoxSizer(wxVERTICAL);
@@ -320,13 +1284,22 @@ public:
         wxBoxSizer *topSizer = new wxBoxSizer(wxHORIZONTAL);
         wxBoxSizer *leftSizer = new wxBoxSizer(wxVERTICAL);
         leftSizer->Add(labSys, 0, wxALL, 5);
-        leftSizer->Add(m_systemChoice, 0, wxALL, 5);
+        leftSizer->Add(m_systemChooser, 0, wxALL | wxEXPAND, 5);
+        leftSizer->Add(labSearch, 0, wxALL, 5);
+        leftSizer->Add(m_search, 0, wxALL | wxEXPAND, 5);
+        leftSizer->Add(m_searchResults, 0, wxALL | wxEXPAND, 5);
         leftSizer->Add(labTasks, 0, wxALL, 5);
         leftSizer->Add(m_taskList, 1, wxEXPAND | wxALL, 5);
         leftSizer->Add(m_startStepsButton, 0, wxALL, 5);
+        wxBoxSizer *packageSizer = new wxBoxSizer(wxHORIZONTAL);
+        packageSizer->Add(m_addToPackageButton, 0, wxRIGHT, 5);
+        packageSizer->Add(btnPackage, 0);
+        leftSizer->Add(packageSizer, 0, wxALL, 5);
 
         // Add the "Change Aircraft" button below or above
         leftSizer->Add(btnChangeAircraft, 0, wxALL, 5);
+        leftSizer->Add(btnImportBatch, 0, wxALL, 5);
+        leftSizer->Add(btnQueryReports, 0, wxALL, 5);
 
         wxBoxSizer *rightSizer = new wxBoxSizer(wxVERTICAL);
         rightSizer->Add(labDetails, 0, wxALL, 5);
@@ -348,102 +1321,398 @@ public:
 
         panel->SetSizer(mainSizer);
 
+        m_stockDisplay->Rebuild();
+    }
+
+    // A reloaded catalog was published: move the views to the new snapshot
+    // and redraw only if the shown system changed. The selected task stays
+    // selected if a task of that name still exists.
+    void ApplyCatalogDiff(const CatalogDiff &diff)
+    {
+        if (!diff.Empty()) {
+            RefreshSystems();
+            RunSearch();
+        }
+        if (m_currentSystem.empty()) return;
+        std::shared_ptr<const TaskCatalog> next = CatalogSnapshot();
+        TaskCatalog::TaskList tasks = VisibleTasks(*next);
+        bool changed = diff.HasSystem(m_currentSystem);
+        std::string selectedName = m_currentTask ? std::string(m_currentTask->name) : std::string();
+        size_t selectedIndex = m_currentTask ? m_currentTask.index : 0;
+
+        m_catalog = next;
+        if (tasks.empty()) {
+            m_taskList->SetTasks(nullptr, {});
+            OnTaskDeselected();
+            return;
+        }
+        m_taskList->SetTasks(m_catalog, tasks, changed);
+        if (selectedName.empty()) return;
+
+        if (changed) {
+            // Task indices may have moved; look the selection up by name once
+            selectedIndex = tasks.size();
+            for (size_t i=0; i<tasks.size(); i++) {
+                if (tasks[i].name == selectedName) {
+                    selectedIndex = i;
+                    break;
+                }
+            }
+        }
+        if (selectedIndex >= tasks.size()) {
+            m_taskList->ClearSelection();
+            OnTaskDeselected();
+            return;
+        }
+        m_currentTask = TaskHandle(m_catalog, tasks, selectedIndex);
+        if (changed) {
+            m_taskList->SelectRow(static_cast<long>(selectedIndex));
+            UpdateTaskDetails(m_currentTask);
+        }
+    }
+
+    // Fill the system chooser from the current catalog snapshot
+    void RefreshSystems()
+    {
+        std::shared_ptr<const TaskCatalog> catalog = CatalogSnapshot();
+        std::vector<std::string> systems;
+        systems.reserve(catalog->SystemCount());
+        for (size_t s = 0; s < catalog->SystemCount(); s++) systems.emplace_back(catalog->SystemName(s));
+        m_systemChooser->SetItems(std::move(systems));
+    }
+
+    // stock.txt was merged into the live stock: redraw only the changed rows,
+    // or the whole list if parts were added to or removed from the file
+    void ApplyStockChanges(const std::vector<PartId> &changed, bool partSetChanged)
+    {
+        if (partSetChanged) {
+            m_stockDisplay->Rebuild();
+            m_dirtyParts.clear();
+            m_package.RecheckStock();
+            if (m_packageDialog) m_packageDialog->StockChanged();
+            return;
+        }
+        m_dirtyParts.insert(m_dirtyParts.end(), changed.begin(), changed.end());
         UpdateStockDisplay();
     }
 
+    // The stock server answered for held cards: report them if their parts
+    // were deducted, else tell the technician to complete them again
+    void SettleDeduction(const StockSettlement &settled)
+    {
+        auto held = m_heldCards.find(settled.request);
+        if (held == m_heldCards.end()) return;
+        std::vector<CompletedCard> cards = std::move(held->second);
+        m_heldCards.erase(held);
+        std::string first = cards[0].system + " / " + std::string(cards[0].task->name);
+        wxString what = wxString::Format("%zu task card(s) (", cards.size()) + wxString::FromUTF8(first.c_str()) +
+                        (cards.size() > 1 ? ", ...)" : ")");
+        switch (settled.outcome) {
+        case DeductResult::Done: {
+            BatchResult result = ReportCards(cards);
+            ShowReported(result);
+            wxMessageBox("The stock server confirmed the deduction; reported " + what + ".",
+                         "Stock Server", wxOK | wxICON_INFORMATION);
+            break;
+        }
+        case DeductResult::Offline:
+            wxMessageBox("The stock server did not deduct the parts of " + what + "; complete them again.",
+                         "Stock Server", wxOK | wxICON_WARNING);
+            break;
+        default:
+            wxMessageBox("The stock server could not tell whether it deducted the parts of " + what +
+                         ". Check the stock before completing them again.",
+                         "Stock Server", wxOK | wxICON_ERROR);
+            break;
+        }
+    }
+
 private:
-    wxChoice    *m_systemChoice;
-    wxListBox   *m_taskList;
+    FilteredChooser *m_systemChooser;
+    wxSearchCtrl *m_search;
+    TaskSearchCtrl *m_searchResults;
+    std::vector<uint32_t> m_searchBuffer;  // swapped with the shown results
+    TaskListCtrl *m_taskList;
     wxTextCtrl  *m_taskDetails;
     wxButton    *m_startStepsButton;
-    wxTextCtrl  *m_stockDisplay;
-    wxTextCtrl  *m_reportOutput;
+    wxButton    *m_addToPackageButton;
+    StockListCtrl *m_stockDisplay;
+    ReportLogCtrl *m_reportOutput;
 
-    // Current selections
+    // Current selections; m_catalog is the snapshot the task list shows
+    std::shared_ptr<const TaskCatalog> m_catalog;
     std::string m_currentSystem;
-    Task        m_currentTask;
+    TaskHandle  m_currentTask;
+
+    // Parts whose quantity changed since the last UpdateStockDisplay()
+    std::vector<PartId> m_dirtyParts;
+
+    TaskDetailsCache m_detailsCache;
+
+    // Planned cards; the dialog is set while it is shown
+    WorkPackage        m_package;
+    WorkPackageDialog *m_packageDialog = nullptr;
+
+    // Completed cards whose deduction the stock server has not confirmed, by request
+    std::map<uint32_t, std::vector<CompletedCard>> m_heldCards;
 
     // --- Event Handlers ---
-    void OnSelectSystem(wxCommandEvent &)
+    void OnSelectSystem(const std::string &system)
     {
+        ScopedTimer timer(Metric::SelectSystem);
         m_currentSystem.clear();
-        m_currentTask = Task{};
-        m_taskList->Clear();
+        m_currentTask = TaskHandle{};
+        m_taskList->SetTasks(nullptr, {});
         m_taskDetails->Clear();
-        m_startStepsButton->Enable(false);
+        EnableTaskButtons(false);
 
-        int sel = m_systemChoice->GetSelection();
-        if (sel == wxNOT_FOUND) return;
+        // Find tasks in the current catalog snapshot
+        ShowSystem(CatalogSnapshot(), system);
+    }
 
-        m_currentSystem = m_systemChoice->GetString(sel).ToStdString();
+    // The current system's tasks that apply to the chosen aircraft type (a
+    // precomputed list in the catalog's applicability index)
+    TaskCatalog::TaskList VisibleTasks(const TaskCatalog &catalog) const
+    {
+        return catalog.Find(m_currentSystem, g_chosenAircraftType);
+    }
 
-        // Find tasks in systemTasks map
-        auto it = systemTasks.find(m_currentSystem);
-        if (it == systemTasks.end()) {
-            // no tasks found
-            return;
-        }
-        // Populate m_taskList
-        for (auto &t : it->second) {
-            m_taskList->Append(t.name);
-        }
+    // Shown after an aircraft was confirmed: its type may differ, so the
+    // lists are fetched again
+    void OnShown(wxShowEvent &event)
+    {
+        event.Skip();
+        if (!event.IsShown()) return;
+        if (!m_currentSystem.empty()) OnSelectSystem(std::string(m_currentSystem));
+        RunSearch();
     }
 
-    void OnTaskSelected(wxCommandEvent &)
+    void ShowSystem(std::shared_ptr<const TaskCatalog> catalog, const std::string &system)
     {
-        int sel = m_taskList->GetSelection();
-        if (sel == wxNOT_FOUND) {
-            m_currentTask = Task{};
-            m_taskDetails->Clear();
-            m_startStepsButton->Enable(false);
+        m_currentSystem = system;
+        m_catalog = std::move(catalog);
+        TaskCatalog::TaskList tasks = VisibleTasks(*m_catalog);
+        if (tasks.empty()) {
+            // no tasks found
             return;
         }
+        // Populate m_taskList (rows are read from the catalog as they are drawn)
+        m_taskList->SetTasks(m_catalog, tasks);
+    }
 
-        std::string chosenTaskName = m_taskList->GetString(sel).ToStdString();
+    // Search as you type: every keystroke is one index lookup
+    void OnSearchText(wxCommandEvent &)
+    {
+        RunSearch();
+    }
 
-        // Find the task in systemTasks[m_currentSystem]
-        auto it = systemTasks.find(m_currentSystem);
-        if (it == systemTasks.end()) return;
+    void OnSearchCancel(wxCommandEvent &)
+    {
+        m_search->ChangeValue("");
+        RunSearch();
+    }
 
-        for (auto &t : it->second) {
-            if (t.name == chosenTaskName) {
-                m_currentTask = t;
-                break;
-            }
+    void RunSearch()
+    {
+        // Single letters would match most of the catalog; wait for a second one
+        static const size_t kMinQueryLength = 2;
+        std::shared_ptr<const TaskCatalog> catalog = CatalogSnapshot();
+        std::string query = m_search->GetValue().utf8_string();
+        std::vector<uint32_t> &results = m_searchBuffer;
+        results.clear();
+        if (query.size() >= kMinQueryLength) catalog->Search().Find(query, results);
+        if (!g_chosenAircraftType.empty()) {
+            results.erase(std::remove_if(results.begin(), results.end(), [&catalog](uint32_t t) {
+                              return !catalog->AppliesTo(t, g_chosenAircraftType);
+                          }), results.end());
         }
+        m_searchResults->SetResults(std::move(catalog), results);
+    }
+
+    // Open a search hit: switch to its system and select it there
+    void OnSearchResultSelected(wxListEvent &event)
+    {
+        long row = event.GetIndex();
+        if (row < 0 || static_cast<size_t>(row) >= m_searchResults->ResultCount()) return;
+        std::shared_ptr<const TaskCatalog> catalog = m_searchResults->Catalog();
+        uint32_t task = m_searchResults->ResultAt(row);
+        size_t sys = catalog->SystemOf(task);
+        std::string system(catalog->SystemName(sys));
+        size_t index = task - catalog->Arrays().systems[sys].firstTask;
+
+        m_systemChooser->Select(system);
+        ShowSystem(catalog, system);
+
+        TaskCatalog::TaskList tasks = VisibleTasks(*m_catalog);
+        size_t taskRow = tasks.RowOf(index);
+        if (taskRow == TaskCatalog::npos) return;
+        m_currentTask = TaskHandle(m_catalog, tasks, taskRow);
+        m_taskList->SelectRow(static_cast<long>(taskRow));
+        UpdateTaskDetails(m_currentTask);
+        EnableTaskButtons(true);
+    }
+
+    void OnTaskSelected(wxListEvent &event)
+    {
+        // The row index is the task's index in VisibleTasks(*m_catalog)
+        if (!m_catalog) return;
+        ScopedTimer timer(Metric::SelectTask);
+        TaskCatalog::TaskList tasks = VisibleTasks(*m_catalog);
+
+        long index = event.GetIndex();
+        if (index < 0 || static_cast<size_t>(index) >= tasks.size()) return;
+        m_currentTask = TaskHandle(m_catalog, tasks, static_cast<size_t>(index));
         UpdateTaskDetails(m_currentTask);
-        m_startStepsButton->Enable(true);
+        EnableTaskButtons(true);
+    }
+
+    void OnTaskDeselected(wxListEvent &)
+    {
+        OnTaskDeselected();
+    }
+
+    void OnTaskDeselected()
+    {
+        m_currentTask = TaskHandle{};
+        m_taskDetails->Clear();
+        EnableTaskButtons(false);
+    }
+
+    void EnableTaskButtons(bool enable)
+    {
+        m_startStepsButton->Enable(enable);
+        m_addToPackageButton->Enable(enable);
     }
 
     void OnStartSteps(wxCommandEvent &)
     {
-        if (m_currentSystem.empty() || m_currentTask.name.empty()) {
+        if (m_currentSystem.empty() || !m_currentTask) {
             wxMessageBox("Please select a system and a task first.", "Error", wxOK | wxICON_ERROR);
             return;
         }
+        // The hot-reload watcher still runs inside the modal loops below and
+        // may replace or clear the selection: the card the technician works
+        // through is the one deducted and reported
+        TaskHandle task = m_currentTask;
+        std::string system = m_currentSystem;
+
+        // Check the stock before the steps are worked through, not after
+        std::vector<PartDemand> missing = StockShortfall(task->requiredParts);
+        if (!missing.empty()) {
+            wxString message = "Not enough parts in stock for this task:\n";
+            for (auto &d : missing) message += "  - " + PartLabel(d) + " missing\n";
+            message += "\nStart the task steps anyway?";
+            if (wxMessageBox(message, "Stock Check", wxYES_NO | wxICON_WARNING) != wxYES) return;
+        }
         // Show the TaskStepsDialog
-        TaskStepsDialog dlg(this, "Task Steps", m_currentTask);
+        TaskStepsDialog dlg(this, "Task Steps", task);
         if (dlg.ShowModal() == wxID_OK) {
             // Step-based tasks completed
             // Now we check/deduct parts, then generate a report
-            if (!CheckAndDeductParts(m_currentTask.requiredParts)) {
+            uint32_t unsettled = 0;
+            switch (DeductStock(task->requiredParts, nullptr, &unsettled)) {
+            case DeductResult::Done:
+                break;
+            case DeductResult::Short:
                 wxMessageBox("Not enough parts in stock. Please restock!", "Error", wxOK | wxICON_ERROR);
                 return;
+            case DeductResult::Offline:
+                wxMessageBox("The stock server is not reachable; no parts were deducted.", "Error",
+                             wxOK | wxICON_ERROR);
+                return;
+            case DeductResult::Unknown:
+                // The server may have deducted the parts: the report waits for its answer
+                m_heldCards[unsettled] = {CompletedCard{g_chosenAircraft, system, task}};
+                wxMessageBox("The stock server did not confirm the deduction. The report is written "
+                             "once it answers whether the parts were deducted.",
+                             "Stock Server", wxOK | wxICON_WARNING);
+                return;
+            }
+            for (auto &d : task->requiredParts) {
+                m_dirtyParts.push_back(d.part);
             }
             // Append to report
-            AppendReport(m_currentSystem, m_currentTask, m_currentTask.requiredParts);
+            uint64_t textOffset = 0;
+            ReportRecord rec = AppendReport(g_chosenAircraft, system, *task, &textOffset);
+            m_reportOutput->Add(std::move(rec), textOffset);
+            RemovePlanned(g_chosenAircraft, system, task->name);
 
             // Clear selection
-            m_taskList->SetSelection(wxNOT_FOUND);
+            m_taskList->ClearSelection();
             m_taskDetails->Clear();
-            m_currentTask = Task{};
-            m_startStepsButton->Enable(false);
+            m_currentTask = TaskHandle{};
+            EnableTaskButtons(false);
 
             // Update stock
             UpdateStockDisplay();
         }
     }
 
+    void OnQueryReports(wxCommandEvent &)
+    {
+        if (!g_reportJournal.IsOpen()) {
+            wxMessageBox("The report journal is not available.", "Query Reports", wxOK | wxICON_ERROR);
+            return;
+        }
+        g_reportWriter.Flush(); // this session's reports are read back from the journal
+        ReportQueryDialog dlg(this, g_reportJournal);
+        dlg.ShowModal();
+    }
+
+    void OnImportBatch(wxCommandEvent &)
+    {
+        wxFileDialog dlg(this, "Import completed task cards", "", "",
+                         "Work orders (*.txt)|*.txt|All files|*", wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+        if (dlg.ShowModal() != wxID_OK) return;
+
+        std::vector<WorkOrder> orders;
+        if (!LoadWorkOrdersFromFile(dlg.GetPath().ToStdString(), orders)) return;
+
+        // Stock is reserved for the whole batch at once; the displays are
+        // refreshed once at the end
+        BatchResult result = CompleteBatch(orders);
+        if (!result.held.empty()) m_heldCards[result.unsettled] = std::move(result.held);
+        if (result.completed) ShowReported(result);
+        if (!result.error.empty()) {
+            wxMessageBox(result.error, "Batch Import", wxOK | (result.completed ? wxICON_WARNING : wxICON_ERROR));
+        } else {
+            wxMessageBox(wxString::Format("%zu task cards completed.", result.completed), "Batch Import",
+                         wxOK | wxICON_INFORMATION);
+        }
+    }
+
+    // Plan the selected card for the chosen aircraft
+    void OnAddToPackage(wxCommandEvent &)
+    {
+        if (!m_currentTask) return;
+        m_package.Add(g_chosenAircraft, m_currentSystem, m_currentTask);
+        wxLogStatus("Work package: %zu tasks, %zu parts short", m_package.Size(), m_package.ShortCount());
+    }
+
+    void OnShowPackage(wxCommandEvent &)
+    {
+        WorkPackageDialog dlg(this, m_package);
+        m_packageDialog = &dlg;
+        dlg.ShowModal();
+        m_packageDialog = nullptr;
+    }
+
+    // Reports of a batch (or of cards held for the stock server) were written
+    void ShowReported(BatchResult &result)
+    {
+        for (auto &r : result.reports) RemovePlanned(r.first.aircraft, r.first.system, r.first.task);
+        m_reportOutput->AddBatch(std::move(result.reports));
+        m_dirtyParts.insert(m_dirtyParts.end(), result.changedParts.begin(), result.changedParts.end());
+        UpdateStockDisplay();
+    }
+
+    // A completed card is no longer planned work
+    void RemovePlanned(const std::string &aircraft, const std::string &system, std::string_view task)
+    {
+        size_t planned = m_package.Find(aircraft, system, task);
+        if (planned != WorkPackage::npos) m_package.Remove(planned);
+    }
+
     void OnChangeAircraft(wxCommandEvent &)
     {
         // Kullanıcı geri dönmek istediğinde bu fonksiyon tetiklenecek.
@@ -461,6 +1730,7 @@ private:
         }
         // Global aircraft değişkenini temizliyoruz (opsiyonel)
         g_chosenAircraft.clear();
+        g_chosenAircraftType.clear();
 
         GetParent()->Layout();
     }
@@ -468,72 +1738,106 @@ private:
     // --- Utility ---
     void UpdateStockDisplay()
     {
-        m_stockDisplay->Clear();
-        for (auto &item : stockInventory) {
-            m_stockDisplay->AppendText(item.first + ": " + std::to_string(item.second) + "\n");
+        // Only the changed rows are redrawn unless the stocked part set changed
+        if (m_stockDisplay->RowCount() != stockParts.size()) {
+            m_stockDisplay->Rebuild();
+            m_package.RecheckStock();
+        } else {
+            m_stockDisplay->RefreshParts(m_dirtyParts);
+            m_package.RecheckStock(m_dirtyParts);
         }
+        m_dirtyParts.clear();
+        if (m_packageDialog) m_packageDialog->StockChanged();
     }
 
-    void UpdateTaskDetails(const Task &task)
+    // One ChangeValue with the cached text instead of a native update per line
+    void UpdateTaskDetails(const TaskHandle &task)
     {
-        m_taskDetails->Clear();
-        m_taskDetails->AppendText("Task Name: " + task.name + "\n\n");
-        m_taskDetails->AppendText("Steps:\n");
-        for (size_t i=0; i<task.steps.size(); i++) {
-            m_taskDetails->AppendText(std::to_string(i+1) + ". " + task.steps[i] + "\n");
-        }
-        m_taskDetails->AppendText("\nRequired Parts:\n");
-        for (auto &p : task.requiredParts) {
-            m_taskDetails->AppendText("- " + p + "\n");
-        }
+        m_taskDetails->Freeze();
+        m_taskDetails->ChangeValue(m_detailsCache.Get(task));
+        m_taskDetails->Thaw();
     }
+};
 
-    bool CheckAndDeductParts(const std::vector<std::string>& parts)
+// --------------------------- Diagnostics ---------------------------
+// Hidden panel (Ctrl+Shift+D) with the latency and allocation counters of the
+// instrumented paths, refreshed every second.
+
+class MetricsListCtrl : public wxListCtrl
+{
+public:
+    MetricsListCtrl(wxWindow *parent)
+        : wxListCtrl(parent, wxID_ANY, wxDefaultPosition, wxSize(620, 260),
+                     wxLC_REPORT | wxLC_VIRTUAL | wxLC_SINGLE_SEL)
     {
-        for (auto &pt : parts) {
-            auto it = stockInventory.find(pt);
-            if (it == stockInventory.end() || it->second < 1) {
-                return false;
-            }
-        }
-        // If all good, deduct
-        for (auto &pt : parts) {
-            stockInventory[pt] -= 1;
-        }
-        return true;
+        InsertColumn(0, "Metric", wxLIST_FORMAT_LEFT, 120);
+        InsertColumn(1, "Calls", wxLIST_FORMAT_RIGHT, 80);
+        InsertColumn(2, "Recent", wxLIST_FORMAT_RIGHT, 70);
+        InsertColumn(3, "p50 us", wxLIST_FORMAT_RIGHT, 80);
+        InsertColumn(4, "p99 us", wxLIST_FORMAT_RIGHT, 80);
+        InsertColumn(5, "Max us", wxLIST_FORMAT_RIGHT, 80);
+        InsertColumn(6, "Allocs/call", wxLIST_FORMAT_RIGHT, 90);
     }
 
-    void AppendReport(const std::string &system, const Task &task, const std::vector<std::string> &usedParts)
+    void SetStats(std::vector<MetricStats> &&stats)
     {
-        static int reportCounter = 1000;
-        reportCounter++;
-        std::string reportID = "RPT-" + std::to_string(reportCounter);
+        m_stats = std::move(stats);
+        SetItemCount(static_cast<long>(m_stats.size()));
+        Refresh();
+    }
 
-        // Current date
-        std::string dateStr = GetCurrentDate();
+private:
+    std::vector<MetricStats> m_stats;
 
-        std::string report = "=== Maintenance Report ===\n";
-        report += "Report ID: " + reportID + "\n";
-        report += "Date: " + dateStr + "\n";
-        if (!g_chosenAircraft.empty())
-            report += "Aircraft: " + g_chosenAircraft + "\n";
-        report += "System: " + system + "\n";
-        report += "Completed Task: " + task.name + "\n";
-        report += "Used Parts:\n";
-        for (auto &p : usedParts) {
-            report += "  - " + p + "\n";
+    wxString OnGetItemText(long item, long column) const override
+    {
+        if (item < 0 || static_cast<size_t>(item) >= m_stats.size()) return wxString();
+        const MetricStats &s = m_stats[item];
+        switch (column) {
+            case 0: return MetricName(s.metric);
+            case 1: return wxString::Format("%llu", static_cast<unsigned long long>(s.calls));
+            case 2: return wxString::Format("%zu", s.samples);
+            case 3: return wxString::Format("%.1f", s.p50Us);
+            case 4: return wxString::Format("%.1f", s.p99Us);
+            case 5: return wxString::Format("%.1f", s.maxUs);
+            case 6: return AllocationsCounted() ? wxString::Format("%.1f", s.allocationsPerCall) : wxString("-");
         }
-        report += "==========================\n\n";
+        return wxString();
+    }
+};
+
+class DiagnosticsDialog : public wxDialog
+{
+public:
+    DiagnosticsDialog(wxWindow *parent)
+        : wxDialog(parent, wxID_ANY, "Diagnostics", wxDefaultPosition, wxSize(650, 340),
+                   wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER),
+          m_refresh(this)
+    {
+        wxPanel *panel = new wxPanel(this, wxID_ANY);
+        wxBoxSizer *mainSizer = new wxBoxSizer(wxVERTICAL);
 
-        m_reportOutput->AppendText(report);
+        mainSizer->Add(new wxStaticText(panel, wxID_ANY,
+            "Recent = samples behind p50/p99 (newest per thread); calls and allocations since start."),
+            0, wxALL | wxEXPAND, 5);
+        m_list = new MetricsListCtrl(panel);
+        mainSizer->Add(m_list, 1, wxALL | wxEXPAND, 5);
+        wxButton *btnClose = new wxButton(panel, wxID_ANY, "Close");
+        btnClose->Bind(wxEVT_BUTTON, &DiagnosticsDialog::OnClose, this);
+        mainSizer->Add(btnClose, 0, wxALL | wxALIGN_RIGHT, 5);
+        panel->SetSizer(mainSizer);
 
-        // Optionally save to file
-        std::ofstream ofs("maintenance_reports.txt", std::ios::app);
-        if (ofs) {
-            ofs << report;
-            ofs.close();
-        }
+        Bind(wxEVT_TIMER, &DiagnosticsDialog::OnRefresh, this);
+        m_list->SetStats(CollectMetrics());
+        m_refresh.Start(1000);
     }
+
+private:
+    MetricsListCtrl *m_list;
+    wxTimer          m_refresh;
+
+    void OnRefresh(wxTimerEvent &) { m_list->SetStats(CollectMetrics()); }
+    void OnClose(wxCommandEvent &) { Close(); }
 };
 
 // --------------------------- MainFrame ---------------------------
@@ -557,11 +1861,161 @@ public:
         sizer->Add(m_aircraftSelectPanel, 1, wxEXPAND);
         sizer->Add(m_maintenancePanel, 1, wxEXPAND);
         SetSizer(sizer);
+
+        // Ctrl+Shift+D opens the hidden diagnostics panel
+        int diagnosticsId = wxWindow::NewControlId();
+        wxAcceleratorEntry entries[1] = {wxAcceleratorEntry(wxACCEL_CTRL | wxACCEL_SHIFT, 'D', diagnosticsId)};
+        SetAcceleratorTable(wxAcceleratorTable(1, entries));
+        Bind(wxEVT_MENU, &MainFrame::OnDiagnostics, this, diagnosticsId);
     }
 
+    // While the catalog and stock load in the background the aircraft
+    // chooser stays disabled
+    void SetLoading(bool loading)
+    {
+        m_aircraftSelectPanel->Enable(!loading);
+    }
+
+    // Startup loading finished: fill the choosers
+    void SetFleet(std::vector<Aircraft> fleet) { m_aircraftSelectPanel->SetFleet(std::move(fleet)); }
+    void RefreshSystems() { m_maintenancePanel->RefreshSystems(); }
+
+    // Forwarded from the loaders and the hot-reload watcher (UI thread)
+    void ApplyCatalogDiff(const CatalogDiff &diff) { m_maintenancePanel->ApplyCatalogDiff(diff); }
+    void ApplyStockChanges(const std::vector<PartId> &changed, bool partSetChanged)
+    {
+        m_maintenancePanel->ApplyStockChanges(changed, partSetChanged);
+    }
+    void SettleDeduction(const StockSettlement &settled) { m_maintenancePanel->SettleDeduction(settled); }
+
 private:
     AircraftSelectPanel *m_aircraftSelectPanel;
     MaintenancePanel    *m_maintenancePanel;
+    DiagnosticsDialog   *m_diagnostics = nullptr;
+
+    // Modeless and single: a second Ctrl+Shift+D brings it to the front
+    void OnDiagnostics(wxCommandEvent &)
+    {
+        if (!m_diagnostics) {
+            m_diagnostics = new DiagnosticsDialog(this);
+            m_diagnostics->Bind(wxEVT_CLOSE_WINDOW, &MainFrame::OnDiagnosticsClosed, this);
+        }
+        m_diagnostics->Show();
+        m_diagnostics->Raise();
+    }
+
+    void OnDiagnosticsClosed(wxCloseEvent &)
+    {
+        m_diagnostics->Destroy();
+        m_diagnostics = nullptr;
+    }
+};
+
+// --------------------------- Hot Reload ---------------------------
+// Watches tasks.txt and stock.txt. Changes are debounced briefly (editors
+// often write a file in several steps), then only the changed file is
+// re-read on a background thread. Back on the UI thread the new catalog
+// snapshot is published atomically and the open panels redraw only what the
+// CatalogDiff / stock merge reports as changed.
+
+class CatalogWatcher : public wxEvtHandler
+{
+public:
+    CatalogWatcher(MainFrame *frame, const std::string &tasksFile, const std::string &stockFile)
+        : m_frame(frame), m_tasksFile(tasksFile), m_stockFile(stockFile), m_debounce(this)
+    {
+        Bind(wxEVT_TIMER, &CatalogWatcher::OnDebounce, this);
+    }
+
+    ~CatalogWatcher()
+    {
+        // Pending CallAfter()s die with this handler; just wait for the worker
+        if (m_worker.joinable()) m_worker.join();
+    }
+
+    // Must be called once the event loop is running
+    bool Start()
+    {
+        if (m_watcher) return true;
+        m_watcher.reset(new wxFileSystemWatcher());
+        m_watcher->Bind(wxEVT_FSWATCHER, &CatalogWatcher::OnFileSystemEvent, this);
+        // Watch the directory: editors often replace a file instead of writing it
+        return m_watcher->Add(wxFileName::DirName(wxGetCwd()),
+                              wxFSW_EVENT_CREATE | wxFSW_EVENT_MODIFY | wxFSW_EVENT_RENAME);
+    }
+
+private:
+    // Result of one background reload
+    struct ReloadResult {
+        std::shared_ptr<const TaskCatalog>  catalog; // null if tasks were not reloaded
+        CatalogDiff                         diff;
+        bool                                stockReloaded = false;
+        std::vector<std::pair<PartId, int>> stock;
+    };
+
+    static const int kDebounceMs = 300;
+
+    MainFrame                           *m_frame;
+    std::string                          m_tasksFile;
+    std::string                          m_stockFile;
+    std::unique_ptr<wxFileSystemWatcher> m_watcher;
+    wxTimer                              m_debounce;
+    bool                                 m_tasksDirty = false;
+    bool                                 m_stockDirty = false;
+    bool                                 m_busy = false; // a reload is running
+    std::thread                          m_worker;
+
+    void OnFileSystemEvent(wxFileSystemWatcherEvent &event)
+    {
+        wxString name = event.GetPath().GetFullName();
+        if (event.GetChangeType() == wxFSW_EVENT_RENAME) name = event.GetNewPath().GetFullName();
+        if (name == m_tasksFile)      m_tasksDirty = true;
+        else if (name == m_stockFile) m_stockDirty = true;
+        else return;
+        m_debounce.StartOnce(kDebounceMs);
+    }
+
+    void OnDebounce(wxTimerEvent &)
+    {
+        if (m_busy || (!m_tasksDirty && !m_stockDirty)) return; // retried when the reload ends
+        bool tasks = m_tasksDirty;
+        bool stock = m_stockDirty;
+        m_tasksDirty = m_stockDirty = false;
+        m_busy = true;
+        if (m_worker.joinable()) m_worker.join();
+        m_worker = std::thread([this, tasks, stock] {
+            auto result = std::make_shared<ReloadResult>();
+            if (tasks) {
+                if (std::shared_ptr<const TaskCatalog> catalog = ReadCatalog(m_tasksFile)) {
+                    result->diff = DiffCatalogs(*CatalogSnapshot(), *catalog);
+                    result->catalog = std::move(catalog);
+                }
+            }
+            if (stock) {
+                result->stockReloaded = ReadStockFile(m_stockFile, result->stock);
+            }
+            CallAfter([this, result] { ApplyReload(*result); });
+        });
+    }
+
+    // UI thread
+    void ApplyReload(ReloadResult &result)
+    {
+        m_busy = false;
+        if (result.catalog && !result.diff.Empty()) {
+            PublishCatalog(result.catalog);
+            m_frame->ApplyCatalogDiff(result.diff);
+            wxLogStatus(m_frame, "Task catalog reloaded: %zu added, %zu removed, %zu changed",
+                        result.diff.addedTasks, result.diff.removedTasks, result.diff.changedTasks);
+        }
+        if (result.stockReloaded) {
+            std::vector<PartId> changed;
+            bool partSetChanged = MergeStockFile(std::move(result.stock), changed);
+            if (!changed.empty()) m_frame->ApplyStockChanges(changed, partSetChanged);
+        }
+        // Changes that arrived while this reload was running
+        if (m_tasksDirty || m_stockDirty) m_debounce.StartOnce(kDebounceMs);
+    }
 };
 
 // --------------------------- Application Class ---------------------------
@@ -570,25 +2024,240 @@ class MROApp : public wxApp
 {
 public:
     virtual bool OnInit();
+    virtual int OnExit();
+
+private:
+    MainFrame                      *m_frame = nullptr;
+    std::unique_ptr<CatalogWatcher> m_watcher;
+    std::string                     m_stockServer; // "host:port", empty for the local stock.txt
+
+    // Background startup loading: tasks and stock load in parallel; the
+    // results are applied on the UI thread once both are done
+    std::thread                         m_tasksLoader;
+    std::thread                         m_stockLoader;
+    int                                 m_pendingLoads = 0;
+    std::shared_ptr<const TaskCatalog>  m_loadedCatalog; // null if loading failed
+    LoadedStock                         m_loadedStock;
+    bool                                m_stockLoaded = false;
+    std::vector<Aircraft>               m_loadedFleet;
+
+    // A dropped stock server connection is retried every kStockReconnectMs
+    // on a background thread
+    wxTimer                             m_reconnectTimer{this};
+    std::thread                         m_reconnector;
+
+    void StartLoading();
+    void StartStockUpdates();
+    void OnLoadProgress(int field, const wxString &text);
+    void OnLoadDone();
+    void OnReconnectTimer(wxTimerEvent &);
+    void OnReconnected(bool connected, std::vector<std::pair<PartId, int>> &&quantities);
 };
 
 wxIMPLEMENT_APP(MROApp);
 
 bool MROApp::OnInit()
 {
-    // 1) Load tasks from "tasks.txt"
-    if (!LoadTasksFromFile("tasks.txt")) {
+    // "--compile-catalog [file]" only builds the binary catalog cache and exits
+    if (argc >= 2 && argv[1] == "--compile-catalog") {
+        CompileCatalog(argc >= 3 ? argv[2].ToStdString() : "tasks.txt");
+        return false;
+    }
+    // "--stock-server host:port" shares the stock of an inventory server
+    // (mro_headless --serve-stock) instead of reading stock.txt
+    // "--metrics-log SECONDS" appends the latency counters to mro_metrics.log
+    for (int i = 1; i + 1 < argc; i++) {
+        if (argv[i] == "--stock-server") m_stockServer = argv[i + 1].ToStdString();
+        if (argv[i] == "--metrics-log") StartMetricsDump("mro_metrics.log", wxAtoi(argv[i + 1]));
+    }
+
+    // Core messages go to the wx log
+    SetLogSink([](LogLevel level, const std::string &message) {
+        if (level == LogLevel::Error) wxLogError("%s", message);
+        else wxLogWarning("%s", message);
+    });
+
+    // 1) Reports are written to "maintenance_reports.txt" and the report
+    //    journal in the background
+    std::string journalFile, indexFile;
+    if (g_reportJournal.Open("maintenance_reports.jrn", "maintenance_reports.jrn.idx")) {
+        journalFile = g_reportJournal.JournalFile();
+        indexFile = g_reportJournal.IndexFile();
+    } else {
+        wxLogWarning("Could not open the report journal maintenance_reports.jrn");
+    }
+    // Report numbers continue where the last session (or the journal) ended
+    g_reportIds.Open("maintenance_reports.id", g_reportJournal.LastReportId());
+    if (!g_reportWriter.Start("maintenance_reports.txt", journalFile, indexFile, kReportSyncIntervalMs)) {
+        wxLogWarning("Could not open maintenance_reports.txt; reports will be written synchronously");
+    }
+
+    // 2) Show MainFrame right away; the catalog and stock load behind it
+    Bind(wxEVT_TIMER, &MROApp::OnReconnectTimer, this);
+    m_frame = new MainFrame("MRO Management System");
+    m_frame->CreateStatusBar(2);
+    m_frame->SetLoading(true);
+    m_frame->Show(true);
+
+    // 3) Load "tasks.txt" (or its up-to-date compiled cache) and "stock.txt"
+    StartLoading();
+    return true;
+}
+
+void MROApp::StartLoading()
+{
+    m_pendingLoads = 2;
+    OnLoadProgress(0, "Loading tasks...");
+    OnLoadProgress(1, "Loading stock...");
+
+    m_tasksLoader = std::thread([this] {
+        std::shared_ptr<const TaskCatalog> catalog = ReadCatalog("tasks.txt", [this](double fraction) {
+            int percent = static_cast<int>(fraction * 100);
+            CallAfter([this, percent] {
+                OnLoadProgress(0, wxString::Format("Loading tasks... %d%%", percent));
+            });
+        });
+        CallAfter([this, catalog] {
+            m_loadedCatalog = catalog;
+            OnLoadDone();
+        });
+    });
+
+    // The fleet file is small and rides along with stock.txt
+    m_stockLoader = std::thread([this] {
+        // Local stock is stock.txt plus its ledger; shared stock is the server's
+        auto stock = std::make_shared<LoadedStock>();
+        if (m_stockServer.empty()) {
+            ReadStock("stock.txt", *stock);
+        } else {
+            stock->fileRead = g_inventoryClient.Connect(m_stockServer, stock->file);
+        }
+        bool ok = stock->restored || stock->fileRead;
+        auto fleet = std::make_shared<std::vector<Aircraft>>();
+        if (!ReadFleetFile("aircraft.txt", *fleet)) {
+            for (const char *type : kDefaultAircraftTypes) fleet->push_back({"", type});
+        }
+        CallAfter([this, stock, ok, fleet] {
+            m_loadedStock = std::move(*stock);
+            m_stockLoaded = ok;
+            m_loadedFleet = std::move(*fleet);
+            OnLoadDone();
+        });
+    });
+}
+
+void MROApp::OnLoadProgress(int field, const wxString &text)
+{
+    if (m_frame) m_frame->SetStatusText(text, field);
+}
+
+// UI thread, once per loader
+void MROApp::OnLoadDone()
+{
+    if (--m_pendingLoads > 0) return;
+    m_tasksLoader.join();
+    m_stockLoader.join();
+
+    if (m_loadedCatalog) {
+        PublishCatalog(std::move(m_loadedCatalog));
+    } else {
         wxMessageBox("Could not load tasks from tasks.txt. Proceeding with empty tasks!", 
                      "Warning", wxOK | wxICON_WARNING);
     }
-    // 2) Load stock from "stock.txt"
-    if (!LoadStockFromFile("stock.txt")) {
+    if (m_stockLoaded) {
+        ApplyStock(std::move(m_loadedStock));
+        if (g_inventoryClient.Active()) StartStockUpdates();
+    } else if (!m_stockServer.empty()) {
+        wxMessageBox("Could not connect to the stock server " + m_stockServer + ". Proceeding with empty stock!",
+                     "Warning", wxOK | wxICON_WARNING);
+    } else {
         wxMessageBox("Could not load stock from stock.txt. Proceeding with empty stock!", 
                      "Warning", wxOK | wxICON_WARNING);
     }
+    m_loadedCatalog.reset();
+    m_loadedStock = LoadedStock();
+
+    OnLoadProgress(0, wxString::Format("%zu tasks", CatalogSnapshot()->TaskCount()));
+    OnLoadProgress(1, wxString::Format("%zu stocked parts%s", stockParts.size(),
+                                       g_inventoryClient.Active() ? " (shared)" : ""));
+    m_frame->SetFleet(std::move(m_loadedFleet));
+    m_loadedFleet.clear();
+    m_frame->RefreshSystems();
+    m_frame->ApplyStockChanges({}, true);
+    m_frame->SetLoading(false);
+
+    // 4) Reload tasks.txt / stock.txt when they change; shared stock is the
+    //    server's to reload
+    m_watcher.reset(new CatalogWatcher(m_frame, "tasks.txt", m_stockServer.empty() ? "stock.txt" : ""));
+    if (!m_watcher->Start()) {
+        wxLogWarning("Could not watch tasks.txt / stock.txt for changes");
+    }
+}
 
-    // 3) Create MainFrame
-    MainFrame *frame = new MainFrame("MRO Management System");
-    frame->Show(true);
-    return true;
+// Quantities changed by other terminals arrive on the client's thread and
+// are redrawn on the UI thread
+void MROApp::StartStockUpdates()
+{
+    g_inventoryClient.Start(
+        [this](std::vector<PartId> changed) {
+            CallAfter([this, changed] {
+                // The frame may already be gone while the app shuts down
+                if (GetTopWindow() == m_frame) m_frame->ApplyStockChanges(changed, false);
+            });
+        },
+        [this] {
+            CallAfter([this] {
+                if (GetTopWindow() != m_frame) return;
+                OnLoadProgress(1, "Stock server disconnected; reconnecting...");
+                m_reconnectTimer.StartOnce(kStockReconnectMs);
+            });
+        },
+        [this](StockSettlement settled) {
+            CallAfter([this, settled] {
+                if (GetTopWindow() == m_frame) m_frame->SettleDeduction(settled);
+            });
+        });
+}
+
+void MROApp::OnReconnectTimer(wxTimerEvent &)
+{
+    if (m_reconnector.joinable()) m_reconnector.join();
+    m_reconnector = std::thread([this] {
+        auto quantities = std::make_shared<std::vector<std::pair<PartId, int>>>();
+        bool connected = g_inventoryClient.Reconnect(*quantities);
+        CallAfter([this, connected, quantities] { OnReconnected(connected, std::move(*quantities)); });
+    });
+}
+
+// UI thread: the server's stock replaces the mirror, and deductions the old
+// connection left unconfirmed are settled once updates start
+void MROApp::OnReconnected(bool connected, std::vector<std::pair<PartId, int>> &&quantities)
+{
+    if (GetTopWindow() != m_frame) return;
+    if (!connected) {
+        m_reconnectTimer.StartOnce(kStockReconnectMs);
+        return;
+    }
+    ApplyStockFile(std::move(quantities));
+    m_frame->ApplyStockChanges({}, true);
+    StartStockUpdates();
+    OnLoadProgress(1, wxString::Format("%zu stocked parts (shared)", stockParts.size()));
+}
+
+int MROApp::OnExit()
+{
+    // A loader still running at exit only gets to finish; its results are dropped
+    if (m_tasksLoader.joinable()) m_tasksLoader.join();
+    if (m_stockLoader.joinable()) m_stockLoader.join();
+    m_watcher.reset();
+    m_reconnectTimer.Stop();
+    if (m_reconnector.joinable()) m_reconnector.join();
+    g_inventoryClient.Disconnect();
+
+    // Make sure every queued report and stock change reaches the disk
+    g_reportWriter.Stop();
+    g_reportIds.Stop();
+    g_stockLedger.Stop();
+    StopMetricsDump();
+    return wxApp::OnExit();
 }
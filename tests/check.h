@@ -0,0 +1,54 @@
+// Minimal checks for the test programs under tests/: a failed CHECK prints
+// its line and the program exits non-zero from TestsDone()
+
+#ifndef MRO_TESTS_CHECK_H
+#define MRO_TESTS_CHECK_H
+
+#include <cstdio>
+#include <filesystem>
+#include <sstream>
+#include <string>
+
+static int g_checkFailures = 0;
+
+#define CHECK(cond)                                                                   \
+    do {                                                                              \
+        if (!(cond)) {                                                                \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);  \
+            g_checkFailures++;                                                        \
+        }                                                                             \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                \
+    do {                                                                              \
+        auto checkA = (a);                                                            \
+        auto checkB = (b);                                                            \
+        if (!(checkA == checkB)) {                                                    \
+            std::ostringstream values;                                                \
+            values << checkA << " != " << checkB;                                     \
+            fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %s\n", __FILE__, __LINE__, \
+                    #a, #b, values.str().c_str());                                    \
+            g_checkFailures++;                                                        \
+        }                                                                             \
+    } while (0)
+
+// An empty scratch directory for one test program
+inline std::string TestDirectory(const std::string &name)
+{
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / ("mro_" + name);
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    return dir.string();
+}
+
+inline int TestsDone(const char *name)
+{
+    if (g_checkFailures) {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, g_checkFailures);
+        return 1;
+    }
+    printf("%s: OK\n", name);
+    return 0;
+}
+
+#endif // MRO_TESTS_CHECK_H
@@ -0,0 +1,78 @@
+// Catalog cache: used only while it matches the bytes of tasks.txt, and
+// rebuilt rather than trusted when its sections are damaged.
+//
+//   g++ -std=c++17 -pthread -I. tests/test_catalog_cache.cpp mro_core.cpp -o test_catalog_cache
+
+#include "mro_core.h"
+#include "tests/check.h"
+
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+static void WriteFile(const std::string &filename, const std::string &text)
+{
+    std::ofstream(filename, std::ios::binary | std::ios::trunc) << text;
+}
+
+static std::string TaskNames(const TaskCatalog &catalog)
+{
+    std::string names;
+    for (size_t t = 0; t < catalog.TaskCount(); t++) names += std::string(catalog.TaskAt(t).name) + ";";
+    return names;
+}
+
+int main()
+{
+    std::string dir = TestDirectory("catalog_cache");
+    std::string tasksFile = dir + "/tasks.txt", cacheFile = tasksFile + ".cat";
+    WriteFile(tasksFile,
+              "Avionics|Instrument Calibration|Connect calibration tools,Re-test accuracy|CalibrationKit,ScrewSet\n"
+              "Hydraulic|Hydraulic Leak Repair|Drain hydraulic fluid,Replace damaged O-rings|HydraulicFluid,O-Ring\n"
+              "Hydraulic|Pump Service|Change hydraulic oil|HydraulicFluid\n");
+
+    std::shared_ptr<const TaskCatalog> catalog = ReadCatalog(tasksFile);
+    CHECK(catalog && fs::exists(cacheFile));
+    CHECK_EQ(TaskNames(*catalog), std::string("Instrument Calibration;Hydraulic Leak Repair;Pump Service;"));
+    catalog = ReadCatalog(tasksFile);
+    CHECK(catalog);
+    CHECK_EQ(catalog->Search().Find("hydraulic").size(), size_t(2));
+
+    // A same-size edit with the modification time restored (cp -p, rsync -t)
+    // still invalidates the cache
+    fs::file_time_type modified = fs::last_write_time(tasksFile);
+    WriteFile(tasksFile,
+              "Avionics|Instrument Calibration|Connect calibration tools,Re-test accuracy|CalibrationKit,ScrewSet\n"
+              "Hydraulic|Hydraulic Leak Rapair|Drain hydraulic fluid,Replace damaged O-rings|HydraulicFluid,O-Ring\n"
+              "Hydraulic|Pump Service|Change hydraulic oil|HydraulicFluid\n");
+    fs::last_write_time(tasksFile, modified);
+    catalog = ReadCatalog(tasksFile);
+    CHECK(catalog);
+    CHECK_EQ(TaskNames(*catalog), std::string("Instrument Calibration;Hydraulic Leak Rapair;Pump Service;"));
+
+    // Damaged sections behind an intact header: the cache is rebuilt
+    uintmax_t cacheSize = fs::file_size(cacheFile);
+    {
+        std::fstream cache(cacheFile, std::ios::binary | std::ios::in | std::ios::out);
+        cache.seekp(static_cast<std::streamoff>(cacheSize / 2));
+        cache << std::string(static_cast<size_t>(cacheSize - cacheSize / 2), '\xff');
+    }
+    catalog = ReadCatalog(tasksFile);
+    CHECK(catalog);
+    CHECK_EQ(catalog->Search().Find("hydraulic").size(), size_t(2));
+    CHECK_EQ(TaskNames(*catalog), std::string("Instrument Calibration;Hydraulic Leak Rapair;Pump Service;"));
+
+    // One flipped bit anywhere after the header
+    {
+        std::fstream cache(cacheFile, std::ios::binary | std::ios::in | std::ios::out);
+        cache.seekg(static_cast<std::streamoff>(cacheSize - 3));
+        char c = static_cast<char>(cache.get());
+        cache.seekp(static_cast<std::streamoff>(cacheSize - 3));
+        cache.put(static_cast<char>(c ^ 0x04));
+    }
+    catalog = ReadCatalog(tasksFile);
+    CHECK(catalog);
+    CHECK_EQ(TaskNames(*catalog), std::string("Instrument Calibration;Hydraulic Leak Rapair;Pump Service;"));
+    CHECK_EQ(catalog->Search().Find("pump").size(), size_t(1));
+    return TestsDone("test_catalog_cache");
+}
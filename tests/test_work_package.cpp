@@ -0,0 +1,86 @@
+// Work package forecast: demand summed across cards, shortfalls that only
+// the whole package runs into, and rechecks after stock changes.
+//
+//   g++ -std=c++17 -pthread -I. tests/test_work_package.cpp mro_core.cpp -o test_work_package
+
+#include "mro_core.h"
+#include "tests/check.h"
+
+int main()
+{
+    PartId seal = g_partRegistry.Intern("Seal");
+    PartId gauge = g_partRegistry.Intern("PressureGauge");
+    PartId oil = g_partRegistry.Intern("OilSet");
+
+    CatalogBuilder builder;
+    builder.BeginTask("Hydraulic", "Leak Repair");
+    builder.AddStep("Replace seals");
+    builder.AddPart(seal, 3);
+    builder.AddPart(gauge, 1);
+    builder.BeginTask("Hydraulic", "Pump Service");
+    builder.AddStep("Change oil");
+    builder.AddPart(seal, 3);
+    builder.AddPart(oil, 2);
+    builder.BeginTask("Hydraulic", "Pressure Check");
+    builder.AddStep("Read gauge");
+    builder.AddPart(gauge, 1);
+    std::shared_ptr<const TaskCatalog> catalog = builder.Build();
+    CHECK(catalog);
+    TaskCatalog::TaskList tasks = catalog->Find("Hydraulic");
+    CHECK_EQ(tasks.size(), size_t(3));
+    TaskHandle leak(catalog, tasks, 0), pump(catalog, tasks, 1), check(catalog, tasks, 2);
+
+    ApplyStockFile({{seal, 5}, {gauge, 1}, {oil, 10}});
+
+    // Each card alone is covered...
+    CHECK(StockShortfall(leak->requiredParts).empty());
+    CHECK(StockShortfall(pump->requiredParts).empty());
+
+    // ...but two aircraft's cards together need 6 seals of 5
+    WorkPackage package;
+    package.Add("TC-ABC", "Hydraulic", leak);
+    package.Add("TC-XYZ", "Hydraulic", pump);
+    CHECK_EQ(package.Parts().size(), size_t(3));
+    CHECK_EQ(package.Parts()[0], seal); // in the order first needed
+    CHECK_EQ(package.Demand(seal), 6);
+    CHECK_EQ(package.Demand(oil), 2);
+    CHECK(package.IsShort(seal));
+    CHECK_EQ(package.Shortfall(seal), 1);
+    CHECK(!package.IsShort(gauge));
+    CHECK(!package.IsShort(oil));
+    CHECK_EQ(package.ShortCount(), size_t(1));
+
+    // A third card makes the single gauge short too
+    package.Add("TC-ABC", "Hydraulic", check);
+    CHECK_EQ(package.Demand(gauge), 2);
+    CHECK(package.IsShort(gauge));
+    CHECK_EQ(package.ShortCount(), size_t(2));
+    CHECK_EQ(package.Find("TC-ABC", "Hydraulic", "Pressure Check"), size_t(2));
+
+    // A restock is picked up by rechecking only the changed part
+    stockInventory.SetQuantity(seal, 6);
+    package.RecheckStock({seal});
+    CHECK(!package.IsShort(seal));
+    CHECK_EQ(package.ShortCount(), size_t(1));
+
+    // A deduction elsewhere leaves the seals short again
+    CHECK(DeductStock(std::vector<PartDemand>{{seal, 2}}) == DeductResult::Done);
+    package.RecheckStock({seal});
+    CHECK(package.IsShort(seal));
+    CHECK_EQ(package.Shortfall(seal), 2);
+    CHECK_EQ(package.ShortCount(), size_t(2));
+
+    // Removing a card gives its demand back; parts no longer needed drop out
+    package.Remove(package.Find("TC-XYZ", "Hydraulic", "Pump Service"));
+    CHECK_EQ(package.Size(), size_t(2));
+    CHECK_EQ(package.Demand(seal), 3);
+    CHECK_EQ(package.Demand(oil), 0);
+    CHECK_EQ(package.Parts().size(), size_t(2));
+    CHECK(!package.IsShort(seal));
+    CHECK_EQ(package.ShortCount(), size_t(1)); // the gauges
+
+    package.Clear();
+    CHECK(package.Parts().empty());
+    CHECK_EQ(package.ShortCount(), size_t(0));
+    return TestsDone("test_work_package");
+}